@@ -0,0 +1,137 @@
+#ifndef BEMCGeometry_H
+#define BEMCGeometry_H
+
+//Compile-time BEMC tower geometry for the 4800 soft ids, built from the same (float)
+//constants and conventions as the original runtime computation in BEMCLocator
+//(checked against it by BEMCLocator::checkGeometry()).
+//C++14 constexpr has no <cmath>, the few functions needed are series that converge
+//quickly for the arguments used here.
+namespace BEMCGeometry {
+
+    constexpr int nModule = 120;
+    constexpr int nEta = 20;
+    constexpr int nSub = 2;
+    constexpr int nes = 40; //nEta * nSub
+    constexpr int nRaw = 4800; //nModule * nEta * nSub
+
+    constexpr float pi = 3.14159265358979323846f;
+    constexpr float radius = 225.405;
+    constexpr float yWidth = 11.174;
+    constexpr float etaMax = 0.984;
+    constexpr float etaMin = 0.0035;
+
+    constexpr double phiOffset[2] = {(72./180.)*pi, (108./180.)*pi};
+    constexpr double phiStep[2] = {-pi/30.0, pi/30.0};
+
+    namespace series {
+        //|x| < 1
+        constexpr double sinh(double x){
+            double term = x, sum = x;
+            for(int k = 1; k < 20; k++){
+                term *= x*x/((2*k)*(2*k + 1));
+                sum += term;
+            }
+            return sum;
+        }
+        //|x| <= pi
+        constexpr double sin(double x){
+            double term = x, sum = x;
+            for(int k = 1; k < 30; k++){
+                term *= -x*x/((2*k)*(2*k + 1));
+                sum += term;
+            }
+            return sum;
+        }
+        constexpr double cos(double x){
+            double term = 1, sum = 1;
+            for(int k = 1; k < 30; k++){
+                term *= -x*x/((2*k - 1)*(2*k));
+                sum += term;
+            }
+            return sum;
+        }
+        //|t| << 1
+        constexpr double atan(double t){
+            double power = t, sum = t;
+            for(int k = 1; k < 30; k++){
+                power *= -t*t;
+                sum += power/(2*k + 1);
+            }
+            return sum;
+        }
+    }
+
+    //softId = 1..4800 -> module, eta and sub index (1-based)
+    constexpr int module(int softId){return (softId - 1)/nes + 1;}
+    constexpr int etaIndex(int softId){return ((softId - 1)%nes)%nEta + 1;}
+    constexpr int subIndex(int softId){return ((softId - 1)%nes)/nEta + 1;}
+
+    constexpr double etaBound(int i){
+        return (i == 0) ? etaMin : (i == nEta) ? etaMax : 0.05*i;
+    }
+    //eta of the tower center on the positive eta side, e = 1..20
+    constexpr double etaCenter(int e){return (etaBound(e) + etaBound(e - 1))/2.;}
+
+    constexpr double phiSub(int s){
+        //atan2(y, radius) with radius > 0
+        return series::atan(((s == 1) ? -yWidth/2.0 : yWidth/2.0)/radius);
+    }
+
+    constexpr double phi(int m, int s){
+        int iphi = (m <= nModule/2) ? m - 1 : m - nModule/2 - 1;
+        int im = (m <= nModule/2) ? 0 : 1;
+        double phiW = (m <= nModule/2) ? -phiSub(s) : phiSub(s);
+        phiW += phiOffset[im] + iphi*phiStep[im];
+        while(phiW >= pi) phiW -= 2*pi;
+        while(phiW < -pi) phiW += 2*pi;
+        if(phiW > (pi - 0.0001)) phiW = -pi;// -pi<=phi<phi
+        return phiW;
+    }
+
+    struct Table {
+        double eta[nRaw];
+        double phi[nRaw];
+        double x[nRaw];
+        double y[nRaw];
+        double z[nRaw];
+
+        constexpr Table() : eta(), phi(), x(), y(), z() {
+            //transcendentals per eta ring and per phi strip, then spread over the towers
+            double etaW[nEta] = {};
+            double zW[nEta] = {};
+            for(int e = 1; e <= nEta; e++){
+                etaW[e-1] = etaCenter(e);
+                zW[e-1] = radius*series::sinh(etaW[e-1]);
+            }
+            double phiW[nModule*nSub] = {};
+            double xW[nModule*nSub] = {};
+            double yW[nModule*nSub] = {};
+            for(int m = 1; m <= nModule; m++){
+                for(int s = 1; s <= nSub; s++){
+                    int i = (m - 1)*nSub + s - 1;
+                    phiW[i] = BEMCGeometry::phi(m, s);
+                    xW[i] = radius*series::cos(phiW[i]);
+                    yW[i] = radius*series::sin(phiW[i]);
+                }
+            }
+            for(int id = 1; id <= nRaw; id++){
+                int m = module(id);
+                int e = etaIndex(id);
+                int i = (m - 1)*nSub + subIndex(id) - 1;
+                double sign = (m <= nModule/2) ? 1 : -1;
+                eta[id-1] = sign*etaW[e-1];
+                z[id-1] = sign*zW[e-1];
+                phi[id-1] = phiW[i];
+                x[id-1] = xW[i];
+                y[id-1] = yW[i];
+            }
+        }
+    };
+
+    //read-only tower table shared by all BEMCLocator instances, defined in BEMCLocator.cpp
+    struct Towers {
+        static constexpr Table table{};
+    };
+}
+
+#endif
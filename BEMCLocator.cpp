@@ -2,98 +2,111 @@
 
 #include "BEMCLocator.h"
 
+#include <cmath>
+
 using namespace std;
 
 ClassImp(BEMCLocator)
 
-BEMCLocator::BEMCLocator(){
-    int mw;
-    for(int i = 0; i < mNModule/2; i++){
-        double phiW = mPhiOffset[0] + i*mPhiStep[0];
-        while(phiW >= pi) phiW -= 2*pi;
-        while(phiW < -pi) phiW += 2*pi;
-        if(phiW > (pi-0.0001)) phiW = -pi;// -pi<=phi<phi
-        mPhiModule[i] = phiW;
-        double phi_w = mPhiBound[1] - phiW;
-        if(phi_w < 0.0) phi_w += 2*pi;
-        if(phi_w < 0.0 || phi_w > 2*pi) cout<<"phi_w = "<<phi_w<<endl;
-        mw = 120 - int(phi_w/mPhiStep[1]);
-        mPhiModule[mw] = phiW;
-    }
-
-    for(int i=0; i<mNEta; i++){
-        mEtaB[i] = 0.05*i;
-    } 
-    mEtaB[mNEta]=mEtaMax; 
-    mEtaB[0]=mEtaMin;
-
-    for(int i=0; i< mNEta; i++){
-        mEta[i]    = (mEtaB[i+1] + mEtaB[i])/2.;
-        mZlocal[i] = mRadius * sinh(mEta[i]);  // z=r/tan(theta) => 1./tan(theta) = sinh(eta)
-    }
-
-    setEtaPhiArrays();
-
-}
+constexpr BEMCGeometry::Table BEMCGeometry::Towers::table;
 
 void BEMCLocator::getBin(const int softId, int &m, int &e, int &s) const {
-    assert(softId >= 1 && softId <= mNRaw);
-    int wid = softId - 1;
-    m = wid / mNes + 1;
-    int j = wid - (m-1)*mNes;
-    s = j / mNEta + 1;
-    e = j%mNEta + 1;
+    assert(softId >= 1 && softId <= BEMCGeometry::nRaw);
+    m = BEMCGeometry::module(softId);
+    e = BEMCGeometry::etaIndex(softId);
+    s = BEMCGeometry::subIndex(softId);
 }
 
 double BEMCLocator::getEta(const int m, const int e) const {
-    assert(m >= 1 && m <= mNModule);
-    assert(e >= 1 && e <= mNEta);
-    return (m <= mNModule/2) ? mEta[e-1] : -mEta[e-1];
+    assert(m >= 1 && m <= BEMCGeometry::nModule);
+    assert(e >= 1 && e <= BEMCGeometry::nEta);
+    return getEta((m-1)*BEMCGeometry::nes + e);
 }
 
 double BEMCLocator::getPhi(const int m, const int s) const {
-    assert(m >= 1 && m <= mNModule);
-    assert(s >= 1 && s <= mNSub);
-    int iphi, im;
-    double phiW;
-    if(m <= mNModule/2){
-        iphi = m-1;
-        im = 0;
-        phiW = -mPhi[s-1];
-    }else{
-        iphi = m-mNModule/2 - 1;
-        im = 1;
-        phiW = mPhi[s-1];
-    }
-
-    phiW += mPhiOffset[im] + iphi*mPhiStep[im];
-
-    while(phiW >= pi) phiW -= 2*pi;
-    while(phiW < -pi) phiW += 2*pi;
-    if(phiW > (pi-0.0001)) phiW = -pi;// -pi<=phi<phi
+    assert(m >= 1 && m <= BEMCGeometry::nModule);
+    assert(s >= 1 && s <= BEMCGeometry::nSub);
+    return getPhi((m-1)*BEMCGeometry::nes + (s-1)*BEMCGeometry::nEta + 1);
+}
 
-    return phiW;
+TVector3 BEMCLocator::getVector(const int softId) const {
+    assert(softId >= 1 && softId <= BEMCGeometry::nRaw);
+    return TVector3(getX(softId), getY(softId), getZ(softId)); 
 }
 
-void BEMCLocator::setEtaPhiArrays(){
-    for(int i = 0; i < mNRaw; i++){
-        int m, e, s;
-        getBin(i+1, m, e, s);
-        towerEta[i] = getEta(m, e);
-        towerPhi[i] = getPhi(m, s);
-        //cout<<"i = "<<i<<", m = "<<m<<", e = "<<e<<", s = "<<s<<", eta = "<<towerEta[i]<<", phi = "<<towerPhi[i]<<endl;
+void BEMCLocator::getTowerKinematics(const TVector3& vtx, TowerKinematics& kin) const {
+    const BEMCGeometry::Table& table = BEMCGeometry::Towers::table;
+    size_t n = kin.softId.size();
+    kin.eta.resize(n);
+    kin.phi.resize(n);
+    kin.etScale.resize(n);
+    kin.ux.resize(n);
+    kin.uy.resize(n);
+    kin.uz.resize(n);
+    double vx = vtx.X(), vy = vtx.Y(), vz = vtx.Z();
+    //gather + sqrt only, so this loop vectorizes
+    for(size_t i = 0; i < n; i++){
+        int id = kin.softId[i] - 1;
+        double dx = table.x[id] - vx;
+        double dy = table.y[id] - vy;
+        double dz = table.z[id] - vz;
+        double rt = sqrt(dx*dx + dy*dy);
+        double r = sqrt(rt*rt + dz*dz);
+        kin.etScale[i] = rt/r;
+        kin.ux[i] = dx/r;
+        kin.uy[i] = dy/r;
+        kin.uz[i] = dz/r;
+    }
+    for(size_t i = 0; i < n; i++){
+        kin.eta[i] = asinh(kin.uz[i]/kin.etScale[i]);
+        kin.phi[i] = atan2(kin.uy[i], kin.ux[i]);
     }
 }
 
-TVector3 BEMCLocator::getVector(const int softId) const {
-    assert(softId >= 1 && softId <= mNRaw);
-    double x, y, z;
-    double phiW = towerPhi[softId-1];
-    x = mRadius * cos(phiW);
-    y = mRadius * sin(phiW);
-    int m, e, s;
-    getBin(softId, m, e, s);
-    if(m <= mNModule/2) z = mZlocal[e-1];
-    else z = -mZlocal[e-1];
-    return TVector3(x, y, z); 
+bool BEMCLocator::checkGeometry(double tolerance){
+    using namespace BEMCGeometry;
+    //runtime geometry as it used to be computed in the constructor
+    const double mYlocal[2] = {-yWidth/2.0, yWidth/2.0};
+    const double mPhi[2] = {atan2(mYlocal[0], radius), atan2(mYlocal[1], radius)};
+    double mEtaB[nEta+1];
+    double mEta[nEta];
+    double mZlocal[nEta];
+    for(int i = 0; i < nEta; i++) mEtaB[i] = 0.05*i;
+    mEtaB[nEta] = etaMax;
+    mEtaB[0] = etaMin;
+    for(int i = 0; i < nEta; i++){
+        mEta[i] = (mEtaB[i+1] + mEtaB[i])/2.;
+        mZlocal[i] = radius * sinh(mEta[i]);
+    }
+
+    int nBad = 0;
+    double maxDiff = 0;
+    for(int id = 1; id <= nRaw; id++){
+        int m = module(id), e = etaIndex(id), s = subIndex(id);
+        int iphi = (m <= nModule/2) ? m-1 : m-nModule/2-1;
+        int im = (m <= nModule/2) ? 0 : 1;
+        double phiW = (m <= nModule/2) ? -mPhi[s-1] : mPhi[s-1];
+        phiW += phiOffset[im] + iphi*phiStep[im];
+        while(phiW >= pi) phiW -= 2*pi;
+        while(phiW < -pi) phiW += 2*pi;
+        if(phiW > (pi-0.0001)) phiW = -pi;
+
+        double ref[5];
+        ref[0] = (m <= nModule/2) ? mEta[e-1] : -mEta[e-1];
+        ref[1] = phiW;
+        ref[2] = radius * cos(phiW);
+        ref[3] = radius * sin(phiW);
+        ref[4] = (m <= nModule/2) ? mZlocal[e-1] : -mZlocal[e-1];
+        const double val[5] = {Towers::table.eta[id-1], Towers::table.phi[id-1], Towers::table.x[id-1], Towers::table.y[id-1], Towers::table.z[id-1]};
+        for(int k = 0; k < 5; k++){
+            double diff = fabs(val[k] - ref[k]);
+            maxDiff = max(maxDiff, diff);
+            if(diff > tolerance*max(1.0, fabs(ref[k]))){
+                if(nBad < 10) cout<<"BEMCLocator: softId "<<id<<" column "<<k<<" table = "<<val[k]<<", runtime = "<<ref[k]<<endl;
+                nBad++;
+            }
+        }
+    }
+    cout<<"BEMCLocator: geometry check "<<(nBad ? "FAILED" : "passed")<<" for "<<nRaw<<" towers, max deviation "<<maxDiff<<endl;
+    return nBad == 0;
 }
@@ -4,58 +4,48 @@
 #include "TMath.h"
 #include "TVector3.h"
 
+#include "BEMCGeometry.h"
+
 #include <iostream>
 #include <cassert>
 #include <vector>
 
+//Tower lookups read the compile-time tables in BEMCGeometry.h, so construction is free
+//and all instances share the same read-only data.
 class BEMCLocator {
 public:
-    BEMCLocator();
+    //Vertex-corrected kinematics of a list of towers, filled by getTowerKinematics()
+    struct TowerKinematics {
+        std::vector<int> softId;
+        std::vector<double> eta;
+        std::vector<double> phi;
+        std::vector<double> etScale; //1/cosh(eta) = Et/E
+        std::vector<double> ux, uy, uz; //unit vector from the vertex
+        void clear(){softId.clear();}
+        size_t size() const {return softId.size();}
+    };
+
+    BEMCLocator() {}
     virtual ~BEMCLocator() {}
 
     void getBin(const int softId, int &m, int &e, int &s) const;
     double getEta(const int m, const int e) const;
-    double getEta(const int softId) const {return towerEta[softId-1];}
+    double getEta(const int softId) const {return BEMCGeometry::Towers::table.eta[softId-1];}
     double getPhi(const int m, const int s) const;
-    double getPhi(const int softId) const {return towerPhi[softId-1];}
-    void setEtaPhiArrays();
+    double getPhi(const int softId) const {return BEMCGeometry::Towers::table.phi[softId-1];}
     TVector3 getVector(const int softId) const;
     TVector3 getTowerPosition(const int softId, TVector3& vtx) const {return getVector(softId)-vtx;}
 
-private:
-    const float pi = TMath::Pi();
-
-    static const int mNModule = 120; 
-    static const int mNEta = 20;
-    static const int mNSub = 2;
-    static const int mNes = 40; //mNEta * mNSub
-    static const int mNRaw = 4800; //mNModule * mNEta * mNSub
-
-    const float mRadius = 225.405;
-    const float mYWidth = 11.174;
-    const float mEtaMax = 0.984;
-    const float mEtaMin = 0.0035;
-    const float mPhiStepHalf = pi/60.0; //(2pi/nModule)
-
-    double mPhiOffset[2] = {(72./180.)*pi, (108./180.)*pi};
-    double mPhiStep[2] = {-pi/30.0, pi/30.0};
-    double mPhiBound[2] = {(75./180.)*pi, (105./180.)*pi};
-    double mYlocal[2] = {-mYWidth/2.0, mYWidth/2.0};
-    double mPhi[2] = {std::atan2(mYlocal[0], mRadius), std::atan2(mYlocal[1], mRadius)};
-    double mYB[3] = {mYlocal[0], 0.0, mYlocal[1]};
-    double mPhiB[3] = {mPhi[0], 0.0, mPhi[1]};
-
-    const int mMaxAdc = 4096;
-
-    double mZlocal[mNEta];
-    double mEta[mNEta];
-    double mEtaB[mNEta+1];
-    double mPhiModule[mNModule];
+    double getX(const int softId) const {return BEMCGeometry::Towers::table.x[softId-1];}
+    double getY(const int softId) const {return BEMCGeometry::Towers::table.y[softId-1];}
+    double getZ(const int softId) const {return BEMCGeometry::Towers::table.z[softId-1];}
+    //One pass over kin.softId using the precomputed positions
+    void getTowerKinematics(const TVector3& vtx, TowerKinematics& kin) const;
 
-    double towerEta[mNRaw];
-    double towerPhi[mNRaw];
+    //Compares the compile-time tables with the runtime (libm) computation they replace
+    static bool checkGeometry(double tolerance = 1e-9);
 
-    ClassDef(BEMCLocator, 1)
+    ClassDef(BEMCLocator, 2)
 };
 
-#endif
\ No newline at end of file
+#endif
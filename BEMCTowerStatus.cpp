@@ -0,0 +1,100 @@
+#define BEMCTowerStatus_cxx
+
+#include "BEMCTowerStatus.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+using namespace std;
+
+BEMCTowerStatus::Table::Table(){
+    fill(bad, bad + nWords, 0);
+    fill(gain, gain + BEMCGeometry::nRaw, 1.0f);
+}
+
+BEMCTowerStatus::BEMCTowerStatus(){
+    shared_ptr<Tables> t = make_shared<Tables>();
+    t->table.resize(1);
+    tables = t;
+    current = &tables->table[0];
+}
+
+bool BEMCTowerStatus::readEntries(string fileName, bool withGain, vector<Entry>& entries){
+    ifstream fin(fileName.c_str());
+    if(!fin){
+        cout<<"BEMCTowerStatus: could not open "<<fileName<<endl;
+        return false;
+    }
+    string line;
+    int nLine = 0;
+    while(getline(fin, line)){
+        nLine++;
+        size_t first = line.find_first_not_of(" \t");
+        if(first == string::npos || line[first] == '#') continue;
+        istringstream ss(line);
+        Entry entry = {0, 0, 0, 1.0f};
+        ss>>entry.runMin>>entry.runMax>>entry.softId;
+        if(withGain) ss>>entry.gain;
+        if(ss.fail() || entry.softId < 1 || entry.softId > BEMCGeometry::nRaw || entry.runMax < entry.runMin){
+            cout<<"BEMCTowerStatus: skipping malformed line "<<nLine<<" in "<<fileName<<endl;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+bool BEMCTowerStatus::load(string badTowerFile, string gainFile){
+    vector<Entry> badEntries, gainEntries;
+    if(!badTowerFile.empty() && !readEntries(badTowerFile, false, badEntries)) return false;
+    if(!gainFile.empty() && !readEntries(gainFile, true, gainEntries)) return false;
+
+    //every run range boundary starts a new table
+    shared_ptr<Tables> t = make_shared<Tables>();
+    for(auto* list : {&badEntries, &gainEntries}){
+        for(auto& entry : *list){
+            t->runEdges.push_back(entry.runMin);
+            t->runEdges.push_back(entry.runMax + 1);
+        }
+    }
+    sort(t->runEdges.begin(), t->runEdges.end());
+    t->runEdges.erase(unique(t->runEdges.begin(), t->runEdges.end()), t->runEdges.end());
+
+    size_t nRanges = t->runEdges.empty() ? 0 : t->runEdges.size() - 1;
+    t->table.resize(nRanges + 1);
+    for(size_t i = 0; i < nRanges; i++){
+        Table& table = t->table[i+1];
+        int run = t->runEdges[i];
+        for(auto& entry : badEntries){
+            if(run < entry.runMin || run > entry.runMax) continue;
+            table.bad[(entry.softId-1) >> 6] |= uint64_t(1) << ((entry.softId-1) & 63);
+        }
+        for(auto& entry : gainEntries){
+            if(run < entry.runMin || run > entry.runMax) continue;
+            table.gain[entry.softId-1] = entry.gain;
+        }
+    }
+
+    tables = t;
+    current = &tables->table[0];
+    currentRun = -1;
+    loaded = true;
+    cout<<"BEMCTowerStatus: "<<badEntries.size()<<" bad tower and "<<gainEntries.size()<<" gain entries in "<<nRanges<<" run ranges"<<endl;
+    return true;
+}
+
+void BEMCTowerStatus::switchRun(int runId){
+    currentRun = runId;
+    const vector<int>& edges = tables->runEdges;
+    size_t i = upper_bound(edges.begin(), edges.end(), runId) - edges.begin();
+    //i == 0: before the first range, i == edges.size(): after the last one
+    current = (i == 0 || i == edges.size()) ? &tables->table[0] : &tables->table[i];
+}
+
+int BEMCTowerStatus::getNBad() const {
+    int n = 0;
+    for(int w = 0; w < nWords; w++) n += __builtin_popcountll(current->bad[w]);
+    return n;
+}
@@ -0,0 +1,62 @@
+#ifndef BEMCTowerStatus_H
+#define BEMCTowerStatus_H
+
+#include "BEMCGeometry.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+//Bad-tower bitmask and gain table keyed by BEMC soft id, one table per run range.
+//The files are parsed once by load(); setRun() only moves a pointer to the table of
+//the new run, so the per-hit cost is one bit test and one multiply. Copies share the
+//(read-only) tables and keep their own current run.
+class BEMCTowerStatus {
+public:
+    BEMCTowerStatus();
+    virtual ~BEMCTowerStatus(){}
+
+    //Either file may be empty, see BEMCTowerFiles/ for the format
+    bool load(std::string badTowerFile, std::string gainFile = "");
+    void setRun(int runId){if(runId != currentRun) switchRun(runId);}
+
+    bool isGood(int softId) const {return !((current->bad[(softId-1) >> 6] >> ((softId-1) & 63)) & 1);}
+    float getGain(int softId) const {return current->gain[softId-1];}
+
+    bool isLoaded() const {return loaded;}
+    int getNBad() const;
+    size_t getNRunRanges() const {return tables->runEdges.empty() ? 0 : tables->runEdges.size() - 1;}
+
+private:
+    static const int nWords = (BEMCGeometry::nRaw + 63)/64;
+
+    struct Table {
+        uint64_t bad[nWords];
+        float gain[BEMCGeometry::nRaw];
+        Table();
+    };
+
+    struct Entry {
+        int runMin;
+        int runMax;
+        int softId;
+        float gain;
+    };
+
+    //table[i+1] covers runs [runEdges[i], runEdges[i+1]), table[0] (all good, gain 1) everything else
+    struct Tables {
+        std::vector<int> runEdges;
+        std::vector<Table> table;
+    };
+
+    std::shared_ptr<const Tables> tables;
+    const Table* current = nullptr;
+    int currentRun = -1;
+    bool loaded = false;
+
+    void switchRun(int runId);
+    static bool readEntries(std::string fileName, bool withGain, std::vector<Entry>& entries);
+};
+
+#endif
@@ -20,6 +20,7 @@
 //----------------------------------------------------------------------------------------------------
 
 #include <iostream>
+#include <mutex>
 #include "StRefMultCorr.h"
 #include "CentralityMaker.h"
 
@@ -30,109 +31,116 @@ ClassImp(CentralityMaker)
 
   CentralityMaker* CentralityMaker::fInstance = 0 ;
 
+  namespace {
+    std::once_flag instanceOnce ;
+    std::once_flag flavorOnce[StRefMultCorr::kNFlavors] ;
+  }
+
 //____________________________________________________________________________________________________
 CentralityMaker::CentralityMaker()
 {
-  // Create instance for centrality classes
-  fRefMultCorr  = new StRefMultCorr("refmult") ;
-  fRefMult2Corr = new StRefMultCorr("refmult2") ;
-  fRefMult3Corr = new StRefMultCorr("refmult3") ;
-  fTofTrayMultCorr = new StRefMultCorr("toftray") ;
-  fgRefMultCorr  = new StRefMultCorr("grefmult") ;
-  fgRefMultCorr_P16id  = new StRefMultCorr("grefmult_P16id") ;
-  fgRefMultCorr_P17id_VpdMB30 = new StRefMultCorr("grefmult_P17id_VpdMB30") ;
-  fgRefMultCorr_P18ih_VpdMB30 = new StRefMultCorr("grefmult_P18ih_VpdMB30") ;
-  fgRefMultCorr_P18ih_VpdMB30_AllLumi = new StRefMultCorr("grefmult_P18ih_VpdMB30_AllLumi") ;
-  fgRefMultCorr_P18ih_VpdMB30_AllLumi_MB5sc = new StRefMultCorr("grefmult_P18ih_VpdMB30_AllLumi_MB5sc") ;
-  fgRefMultCorr_VpdMB30 = new StRefMultCorr("grefmult_VpdMB30") ;
-  fgRefMultCorr_VpdMBnoVtx = new StRefMultCorr("grefmult_VpdMBnoVtx") ;
+  // Centrality classes are created on first request, see getRefMultCorr(flavor)
+  for(Int_t i = 0; i < StRefMultCorr::kNFlavors; i++) fRefMultCorr[i] = 0 ;
 }
 
 //____________________________________________________________________________________________________
 CentralityMaker::~CentralityMaker()
-{ }
+{
+  for(Int_t i = 0; i < StRefMultCorr::kNFlavors; i++) delete fRefMultCorr[i] ;
+}
 
 //____________________________________________________________________________________________________
 CentralityMaker* CentralityMaker::instance()
 {
-  if ( !fInstance ) {
-    // Initialize StRefMultCorr only once
-    fInstance = new CentralityMaker() ;
-  }
+  // Initialize CentralityMaker only once, also with concurrent callers
+  std::call_once(instanceOnce, [](){ fInstance = new CentralityMaker() ; });
 
   return fInstance ;
 }
 
+//____________________________________________________________________________________________________
+StRefMultCorr* CentralityMaker::getRefMultCorr(const StRefMultCorr::Flavor flavor)
+{
+  if ( flavor < 0 || flavor >= StRefMultCorr::kNFlavors ) return 0 ;
+
+  // Read the input files of this flavor only once; concurrent callers wait for the first one
+  std::call_once(flavorOnce[flavor], [this, flavor](){
+    fRefMultCorr[flavor] = new StRefMultCorr(StRefMultCorr::getFlavorName(flavor)) ;
+  });
+
+  return fRefMultCorr[flavor] ;
+}
+
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getRefMultCorr()
 {
-  return fRefMultCorr ;
+  return getRefMultCorr(StRefMultCorr::kRefMult) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getRefMult2Corr()
 {
-  return fRefMult2Corr ;
+  return getRefMultCorr(StRefMultCorr::kRefMult2) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getRefMult3Corr()
 {
-  return fRefMult3Corr ;
+  return getRefMultCorr(StRefMultCorr::kRefMult3) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getTofTrayMultCorr()
 {
-  return fTofTrayMultCorr ;
+  return getRefMultCorr(StRefMultCorr::kTofTray) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr()
 {
-  return fgRefMultCorr ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_P16id()
 {
-    return fgRefMultCorr_P16id ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_P16id) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_P17id_VpdMB30()
 {
-    return fgRefMultCorr_P17id_VpdMB30 ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_P17id_VpdMB30) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_P18ih_VpdMB30()
 {
-    return fgRefMultCorr_P18ih_VpdMB30 ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_P18ih_VpdMB30) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_P18ih_VpdMB30_AllLumi()
 {
-    return fgRefMultCorr_P18ih_VpdMB30_AllLumi ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_P18ih_VpdMB30_AllLumi) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_P18ih_VpdMB30_AllLumi_MB5sc()
 {
-    return fgRefMultCorr_P18ih_VpdMB30_AllLumi_MB5sc;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_P18ih_VpdMB30_AllLumi_MB5sc) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_VpdMB30()
 {
-    return fgRefMultCorr_VpdMB30 ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_VpdMB30) ;
 }
 
 //____________________________________________________________________________________________________
 StRefMultCorr* CentralityMaker::getgRefMultCorr_VpdMBnoVtx()
 {
-    return fgRefMultCorr_VpdMBnoVtx ;
+  return getRefMultCorr(StRefMultCorr::kgRefMult_VpdMBnoVtx) ;
 }
 
 //____________________________________________________________________________________________________
@@ -34,16 +34,20 @@
 #ifndef __CentralityMaker_h__
 #define __CentralityMaker_h__
 
-class StRefMultCorr ;
 #include "Rtypes.h"
+#include "StRefMultCorr.h"
 
 //____________________________________________________________________________________________________
 class CentralityMaker {
   public:
-    static CentralityMaker* instance(); // Use this function to access StRefMultCorr
+    static CentralityMaker* instance(); // Use this function to access StRefMultCorr (thread-safe)
     virtual ~CentralityMaker(); /// Default destructor
 
     // Interface
+    //   * Each StRefMultCorr is built (and its files read) on the first request, thread-safe
+    //   * The returned instance is owned by CentralityMaker and shared by all callers,
+    //     use StRefMultCorr::clone() for an independent per-thread copy
+    StRefMultCorr* getRefMultCorr(const StRefMultCorr::Flavor flavor) ;
     StRefMultCorr* getRefMultCorr()  ; // For refmult
     StRefMultCorr* getRefMult2Corr() ; // For refmult2
     StRefMultCorr* getRefMult3Corr() ; // For refmult3
@@ -64,19 +68,8 @@ class CentralityMaker {
     CentralityMaker() ; // Constructor is private
     static CentralityMaker* fInstance ; // Static pointer of CentralityMaker
 
-    // Centrality correction classes
-    StRefMultCorr* fRefMultCorr  ; // refmult based centrality
-    StRefMultCorr* fRefMult2Corr ; // refmult2 based centrality
-    StRefMultCorr* fRefMult3Corr ; // refmult3 based centrality
-    StRefMultCorr* fTofTrayMultCorr ; // tofTrayMult based centrality
-    StRefMultCorr* fgRefMultCorr  ; // grefmult based centrality
-    StRefMultCorr* fgRefMultCorr_P16id  ; // grefmult based centrality, P16id
-    StRefMultCorr* fgRefMultCorr_P17id_VpdMB30; // for P17id, VPDMB-30; |vz| < 30
-    StRefMultCorr* fgRefMultCorr_P18ih_VpdMB30; // for P18ih, VPDMB-30; |vz| < 30, added June10, 2019 (New Run14 production)
-    StRefMultCorr* fgRefMultCorr_P18ih_VpdMB30_AllLumi; // for P18ih, VPDMB-30; |vz| < 30, added August15, 2019, Run14 production, for ALL luminosities
-    StRefMultCorr* fgRefMultCorr_P18ih_VpdMB30_AllLumi_MB5sc; // for P18ih, VPDMB-30; |vz| < 30, added August15, 2019, Run14 production, for ALL luminosities
-    StRefMultCorr* fgRefMultCorr_VpdMB30; // for VPDMB-30; |vz| < 30
-    StRefMultCorr* fgRefMultCorr_VpdMBnoVtx; //  for VPDMB-noVtx; |vz| < 100
+    // Centrality correction classes, indexed by StRefMultCorr::Flavor, null until requested
+    StRefMultCorr* fRefMultCorr[StRefMultCorr::kNFlavors] ; //!
 
     ClassDef(CentralityMaker, 0)
 };
@@ -0,0 +1,37 @@
+#ifndef CounterRandom_H
+#define CounterRandom_H
+
+#include <cstdint>
+
+//Counter-based random numbers (Philox4x32-10, Salmon et al., SC'11): the output
+//is a pure function of (key, counter), so a number keyed by (runId, eventId) is
+//the same for any thread count, event order or sharding of the input.
+class CounterRandom {
+public:
+    //Uniform in (0, 1], like TRandom::Rndm(); counter selects independent draws for the same key
+    static double uniform(uint32_t key0, uint32_t key1, uint32_t counter = 0){
+        uint32_t ctr[4] = {counter, 0, 0, 0};
+        uint32_t key[2] = {key0, key1};
+        philox(ctr, key);
+        //53 random bits
+        uint64_t bits = ((uint64_t)(ctr[0] >> 5) << 26) | (ctr[1] >> 6);
+        return (bits + 1)*(1.0/9007199254740992.0);
+    }
+
+    static void philox(uint32_t ctr[4], uint32_t key[2]){
+        for(int round = 0; round < 10; round++){
+            uint64_t p0 = (uint64_t)0xD2511F53u*ctr[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57u*ctr[2];
+            uint32_t c0 = (uint32_t)(p1 >> 32) ^ ctr[1] ^ key[0];
+            uint32_t c2 = (uint32_t)(p0 >> 32) ^ ctr[3] ^ key[1];
+            ctr[0] = c0;
+            ctr[1] = (uint32_t)p1;
+            ctr[2] = c2;
+            ctr[3] = (uint32_t)p0;
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,214 @@
+#define EventPlaneCalibrator_cxx
+
+#include "EventPlaneCalibrator.h"
+
+#include "TFile.h"
+#include "TProfile2D.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+EventPlaneCalibrator::EventPlaneCalibrator(unsigned int nHarm, unsigned int nFlat){
+    nHarmonics = (nHarm > 0) ? nHarm : 1;
+    nFlatten = min(nFlat, maxFlatten);
+    double edges[2] = {-1e10, 1e10};
+    setBinning(1, edges, 1, edges);
+}
+
+void EventPlaneCalibrator::setBinning(int nVar1Bins, const double* var1Bins, int nVar2Bins, const double* var2Bins){
+    var1Edges.assign(var1Bins, var1Bins + nVar1Bins + 1);
+    var2Edges.assign(var2Bins, var2Bins + nVar2Bins + 1);
+    runSlots.clear();
+    cells.assign(nVar1Bins*nVar2Bins*nSubEvents*nHarmonics, Cell());
+    recenteringFromFile = false;
+    ready = false;
+}
+
+size_t EventPlaneCalibrator::findBin(const vector<double>& edges, double v){
+    //values outside the axis use the edge bins
+    size_t nBins = edges.size() - 1;
+    size_t bin = upper_bound(edges.begin(), edges.end(), v) - edges.begin();
+    if(bin == 0) return 0;
+    if(bin > nBins) return nBins - 1;
+    return bin - 1;
+}
+
+size_t EventPlaneCalibrator::getSlot(int runId){
+    auto it = runSlots.find(runId);
+    if(it != runSlots.end()) return it->second;
+    size_t slot = runSlots.size() + 1;
+    runSlots[runId] = slot;
+    size_t nCellsPerSlot = (var1Edges.size() - 1)*(var2Edges.size() - 1)*nSubEvents*nHarmonics;
+    cells.resize((slot + 1)*nCellsPerSlot);
+    return slot;
+}
+
+const EventPlaneCalibrator::Cell& EventPlaneCalibrator::selectCell(size_t runIdx, size_t allIdx, bool recentering) const {
+    if(recentering && recenteringFromFile) return cells[allIdx];
+    if(runIdx != allIdx && cells[runIdx].nEvents >= minEventsPerRun) return cells[runIdx];
+    return cells[allIdx];
+}
+
+void EventPlaneCalibrator::recenter(const Cell& cell, unsigned int mult, double& Qx, double& Qy) const {
+    //the p2Q*_raw profiles average over tracks, so the event offset scales with multiplicity
+    if(cell.sumMult <= 0) return;
+    Qx -= mult*cell.sumQx/cell.sumMult;
+    Qy -= mult*cell.sumQy/cell.sumMult;
+}
+
+bool EventPlaneCalibrator::loadRawProfiles(string fileName, unsigned int n){
+    if(n < 1 || n > nHarmonics){
+        cout<<"EventPlaneCalibrator: harmonic "<<n<<" is not calibrated (nHarmonics = "<<nHarmonics<<")"<<endl;
+        return false;
+    }
+    TFile file(fileName.c_str(), "READ");
+    if(file.IsZombie()){
+        cout<<"EventPlaneCalibrator: could not open "<<fileName<<endl;
+        return false;
+    }
+    const char* names[nSubEvents][2] = {{"p2Qx_raw", "p2Qy_raw"}, {"p2Qx_A_raw", "p2Qy_A_raw"}, {"p2Qx_B_raw", "p2Qy_B_raw"}};
+    TProfile2D* prof[nSubEvents][2];
+    for(unsigned int sub = 0; sub < nSubEvents; sub++){
+        for(int xy = 0; xy < 2; xy++){
+            prof[sub][xy] = nullptr;
+            file.GetObject(names[sub][xy], prof[sub][xy]);
+            if(!prof[sub][xy]){
+                cout<<"EventPlaneCalibrator: "<<names[sub][xy]<<" not found in "<<fileName<<endl;
+                return false;
+            }
+        }
+    }
+
+    //the lookup table takes its binning from the profile axes
+    vector<double> edges1, edges2;
+    const TAxis* axis1 = prof[0][0]->GetXaxis();
+    const TAxis* axis2 = prof[0][0]->GetYaxis();
+    for(int i = 1; i <= axis1->GetNbins(); i++) edges1.push_back(axis1->GetBinLowEdge(i));
+    edges1.push_back(axis1->GetBinUpEdge(axis1->GetNbins()));
+    for(int i = 1; i <= axis2->GetNbins(); i++) edges2.push_back(axis2->GetBinLowEdge(i));
+    edges2.push_back(axis2->GetBinUpEdge(axis2->GetNbins()));
+    setBinning(edges1.size() - 1, edges1.data(), edges2.size() - 1, edges2.data());
+
+    for(unsigned int sub = 0; sub < nSubEvents; sub++){
+        for(size_t i1 = 0; i1 + 1 < edges1.size(); i1++){
+            for(size_t i2 = 0; i2 + 1 < edges2.size(); i2++){
+                int gbin = prof[sub][0]->GetBin(i1 + 1, i2 + 1);
+                Cell& cell = cells[cellIndex(0, i1*(edges2.size() - 1) + i2, sub, n)];
+                cell.sumMult = prof[sub][0]->GetBinEntries(gbin);
+                cell.sumQx = prof[sub][0]->GetBinContent(gbin)*cell.sumMult;
+                cell.sumQy = prof[sub][1]->GetBinContent(gbin)*prof[sub][1]->GetBinEntries(gbin);
+            }
+        }
+    }
+    recenteringFromFile = true;
+    ready = true;
+    cout<<"EventPlaneCalibrator: recentering for n = "<<n<<" loaded from "<<fileName<<endl;
+    return true;
+}
+
+void EventPlaneCalibrator::beginPass(){
+    accumulating = true;
+    ready = false;
+    recordSlots.clear();
+    recordBins.clear();
+    recordQ.clear();
+    recordMult.clear();
+}
+
+void EventPlaneCalibrator::record(int runId, double var1, double var2, unsigned int nHarm, const double* Qx, const double* Qy, const unsigned int* mult){
+    if(!accumulating) return;
+    size_t slot = getSlot(runId);
+    size_t bin = getBin(var1, var2);
+    //recentering sums are final after the pass, flattening needs them and is done in endPass()
+    for(size_t s : {(size_t)0, slot}){
+        for(unsigned int sub = 0; sub < nSubEvents; sub++){
+            for(unsigned int n = 1; n <= nHarmonics; n++){
+                Cell& cell = cells[cellIndex(s, bin, sub, n)];
+                cell.nEvents += 1;
+                if(recenteringFromFile || n > nHarm) continue;
+                cell.sumQx += Qx[sub*nHarm + n - 1];
+                cell.sumQy += Qy[sub*nHarm + n - 1];
+                cell.sumMult += mult[sub];
+            }
+        }
+    }
+    recordSlots.push_back(slot);
+    recordBins.push_back(bin);
+    for(unsigned int sub = 0; sub < nSubEvents; sub++){
+        for(unsigned int n = 1; n <= nHarmonics; n++){
+            recordQ.push_back((n <= nHarm) ? Qx[sub*nHarm + n - 1] : 0);
+            recordQ.push_back((n <= nHarm) ? Qy[sub*nHarm + n - 1] : 0);
+        }
+        recordMult.push_back(mult[sub]);
+    }
+}
+
+void EventPlaneCalibrator::endPass(){
+    size_t nRecords = recordSlots.size();
+    for(size_t r = 0; r < nRecords; r++){
+        const double* Q = &recordQ[r*nSubEvents*nHarmonics*2];
+        for(size_t s : {(size_t)0, recordSlots[r]}){
+            for(unsigned int sub = 0; sub < nSubEvents; sub++){
+                for(unsigned int n = 1; n <= nHarmonics; n++){
+                    size_t idx = cellIndex(s, recordBins[r], sub, n);
+                    size_t recIdx = recenteringFromFile ? cellIndex(0, recordBins[r], sub, n) : idx;
+                    double Qx = Q[(sub*nHarmonics + n - 1)*2];
+                    double Qy = Q[(sub*nHarmonics + n - 1)*2 + 1];
+                    recenter(cells[recIdx], recordMult[r*nSubEvents + sub], Qx, Qy);
+                    double q = sqrt(Qx*Qx + Qy*Qy);
+                    if(q <= 0) continue;
+                    //<cos(k n psi)>, <sin(k n psi)> from powers of the unit Q-vector
+                    double c = Qx/q, sn = Qy/q;
+                    double ck = 1, sk = 0;
+                    Cell& cell = cells[idx];
+                    for(unsigned int k = 1; k <= nFlatten; k++){
+                        double t = ck*c - sk*sn;
+                        sk = sk*c + ck*sn;
+                        ck = t;
+                        cell.sumCos[k-1] += ck;
+                        cell.sumSin[k-1] += sk;
+                    }
+                }
+            }
+        }
+    }
+    cout<<"EventPlaneCalibrator: calibrated on "<<nRecords<<" events from "<<runSlots.size()<<" runs"<<endl;
+
+    recordSlots.clear(); recordSlots.shrink_to_fit();
+    recordBins.clear(); recordBins.shrink_to_fit();
+    recordQ.clear(); recordQ.shrink_to_fit();
+    recordMult.clear(); recordMult.shrink_to_fit();
+    accumulating = false;
+    ready = true;
+}
+
+void EventPlaneCalibrator::apply(int runId, double var1, double var2, unsigned int nHarm, double* Qx, double* Qy, const unsigned int* mult, double* psi) const {
+    size_t bin = getBin(var1, var2);
+    auto it = runSlots.find(runId);
+    for(unsigned int sub = 0; sub < nSubEvents; sub++){
+        for(unsigned int n = 1; n <= nHarm; n++){
+            size_t i = sub*nHarm + n - 1;
+            if(n <= nHarmonics){
+                size_t allIdx = cellIndex(0, bin, sub, n);
+                size_t runIdx = (it == runSlots.end()) ? allIdx : cellIndex(it->second, bin, sub, n);
+                recenter(selectCell(runIdx, allIdx, true), mult[sub], Qx[i], Qy[i]);
+                double nPsi = atan2(Qy[i], Qx[i]);
+                const Cell& cell = selectCell(runIdx, allIdx, false);
+                if(cell.nEvents > 0){
+                    double dPsi = 0;
+                    for(unsigned int k = 1; k <= nFlatten; k++){
+                        dPsi += 2.0/k*(cell.sumCos[k-1]/cell.nEvents*sin(k*nPsi) - cell.sumSin[k-1]/cell.nEvents*cos(k*nPsi));
+                    }
+                    nPsi += dPsi;
+                }
+                psi[i] = atan2(sin(nPsi), cos(nPsi))/n;
+            }
+            else{
+                psi[i] = atan2(Qy[i], Qx[i])/n;
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef EventPlaneCalibrator_H
+#define EventPlaneCalibrator_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+//Recentering and Fourier flattening constants for the event plane, indexed by
+//(run, var1, var2) with var1/var2 the axes of the p2*_raw profiles (vz, centrality).
+//Q-vector arrays passed in and out are laid out as [sub*nHarmonics + n-1] with
+//sub = 0 (full event), 1 (A, eta > 0), 2 (B, eta <= 0).
+class EventPlaneCalibrator {
+public:
+    EventPlaneCalibrator(unsigned int nHarm = 2, unsigned int nFlat = 4);
+    virtual ~EventPlaneCalibrator(){}
+
+    void setBinning(int nVar1Bins, const double* var1Bins, int nVar2Bins, const double* var2Bins);
+    //Cells with fewer events for a given run fall back to the run-integrated constants
+    void setMinEventsPerRun(double n){minEventsPerRun = n;}
+
+    //Run-independent recentering for harmonic n from the p2Q*_raw profiles written by EventPlaneMaker
+    bool loadRawProfiles(std::string fileName, unsigned int n);
+
+    //In-memory calibration pass: record() raw Q-vectors between beginPass() and endPass()
+    void beginPass();
+    void record(int runId, double var1, double var2, unsigned int nHarm, const double* Qx, const double* Qy, const unsigned int* mult);
+    void endPass();
+
+    //Recenters Qx/Qy in place and returns the flattened planes in psi
+    void apply(int runId, double var1, double var2, unsigned int nHarm, double* Qx, double* Qy, const unsigned int* mult, double* psi) const;
+
+    bool isAccumulating() const {return accumulating;}
+    bool isReady() const {return ready;}
+    unsigned int getNHarmonics() const {return nHarmonics;}
+
+private:
+    static const unsigned int maxFlatten = 8;
+    static const unsigned int nSubEvents = 3;
+
+    struct Cell {
+        double nEvents = 0;
+        double sumQx = 0;
+        double sumQy = 0;
+        double sumMult = 0;
+        double sumCos[maxFlatten] = {};
+        double sumSin[maxFlatten] = {};
+    };
+
+    unsigned int nHarmonics = 2;
+    unsigned int nFlatten = 4;
+    double minEventsPerRun = 100;
+    bool recenteringFromFile = false;
+    bool accumulating = false;
+    bool ready = false;
+
+    std::vector<double> var1Edges;
+    std::vector<double> var2Edges;
+
+    //slot 0 holds the run-integrated constants
+    std::unordered_map<int, size_t> runSlots;
+    std::vector<Cell> cells;
+
+    //raw Q-vectors of the calibration pass, replayed by endPass() for the flattening stage
+    std::vector<size_t> recordSlots;
+    std::vector<size_t> recordBins;
+    std::vector<double> recordQ;
+    std::vector<unsigned int> recordMult;
+
+    static size_t findBin(const std::vector<double>& edges, double v);
+    size_t getSlot(int runId);
+    size_t cellIndex(size_t slot, size_t bin, unsigned int sub, unsigned int n) const {return ((slot*(var1Edges.size() - 1)*(var2Edges.size() - 1) + bin)*nSubEvents + sub)*nHarmonics + n - 1;}
+    size_t getBin(double var1, double var2) const {return findBin(var1Edges, var1)*(var2Edges.size() - 1) + findBin(var2Edges, var2);}
+    const Cell& selectCell(size_t runIdx, size_t allIdx, bool recentering) const;
+    void recenter(const Cell& cell, unsigned int mult, double& Qx, double& Qy) const;
+};
+
+#endif
@@ -1,47 +1,64 @@
 #define EventPlaneMaker_cxx
 
 #include "EventPlaneMaker.h"
+#include "EventPlaneCalibrator.h"
 
 #include "JetVector.h"
+#include "TTreeEvent.h"
 
 #include "TFile.h"
 #include "TProfile2D.h"
+#include "TMath.h"
 
 #include <iostream>
 
 using namespace std;
 
-map<string, function<double(EventPlaneMaker&)>> EventPlaneMaker::epVars = {
-    {"Qx",                    [](EventPlaneMaker& ep){return ep.getQx();              }},
-    {"Qy",                    [](EventPlaneMaker& ep){return ep.getQy();              }},
-    {"Qx_A",                  [](EventPlaneMaker& ep){return ep.getQx_A();            }},
-    {"Qy_A",                  [](EventPlaneMaker& ep){return ep.getQy_A();            }},
-    {"Qx_B",                  [](EventPlaneMaker& ep){return ep.getQx_B();            }},
-    {"Qy_B",                  [](EventPlaneMaker& ep){return ep.getQy_B();            }},
-    {"psi",                   [](EventPlaneMaker& ep){return ep.getPsi();             }},
-    {"psi_A",                 [](EventPlaneMaker& ep){return ep.getPsi_A();           }},
-    {"psi_B",                 [](EventPlaneMaker& ep){return ep.getPsi_B();           }},
-    {"eventPlaneWeight",      [](EventPlaneMaker& ep){return ep.getEventWeight();     }},
-    {"subEventPlaneWeight_A", [](EventPlaneMaker& ep){return ep.getSubEventWeight_A();}},
-    {"subEventPlaneWeight_B", [](EventPlaneMaker& ep){return ep.getSubEventWeight_B();}},
-    {"eventPlaneMult",        [](EventPlaneMaker& ep){return ep.getEventMult();       }},
-    {"subEventPlaneMult_A",   [](EventPlaneMaker& ep){return ep.getSubEventMult_A();  }},
-    {"subEventPlaneMult_B",   [](EventPlaneMaker& ep){return ep.getSubEventMult_B();  }}
+map<string, EventPlaneMaker::EPVar> EventPlaneMaker::epVars = {
+    {"Qx",                    [](EventPlaneMaker& ep) -> double {return ep.getQx();              }},
+    {"Qy",                    [](EventPlaneMaker& ep) -> double {return ep.getQy();              }},
+    {"Qx_A",                  [](EventPlaneMaker& ep) -> double {return ep.getQx_A();            }},
+    {"Qy_A",                  [](EventPlaneMaker& ep) -> double {return ep.getQy_A();            }},
+    {"Qx_B",                  [](EventPlaneMaker& ep) -> double {return ep.getQx_B();            }},
+    {"Qy_B",                  [](EventPlaneMaker& ep) -> double {return ep.getQy_B();            }},
+    {"psi",                   [](EventPlaneMaker& ep) -> double {return ep.getPsi();             }},
+    {"psi_A",                 [](EventPlaneMaker& ep) -> double {return ep.getPsi_A();           }},
+    {"psi_B",                 [](EventPlaneMaker& ep) -> double {return ep.getPsi_B();           }},
+    {"eventPlaneWeight",      [](EventPlaneMaker& ep) -> double {return ep.getEventWeight();     }},
+    {"subEventPlaneWeight_A", [](EventPlaneMaker& ep) -> double {return ep.getSubEventWeight_A();}},
+    {"subEventPlaneWeight_B", [](EventPlaneMaker& ep) -> double {return ep.getSubEventWeight_B();}},
+    {"eventPlaneMult",        [](EventPlaneMaker& ep) -> double {return ep.getEventMult();       }},
+    {"subEventPlaneMult_A",   [](EventPlaneMaker& ep) -> double {return ep.getSubEventMult_A();  }},
+    {"subEventPlaneMult_B",   [](EventPlaneMaker& ep) -> double {return ep.getSubEventMult_B();  }}
 };
 
 EventPlaneMaker::EventPlaneMaker(unsigned int n){
-    N = n;
+    setN(n);
     cout<<"EventPlaneMaker::EventPlaneMaker() N = "<<N<<endl;
 }
 
+void EventPlaneMaker::setN(unsigned int n){
+    N = (n > 0) ? n : 1;
+    if(N > (unsigned int)TTreeEvent::kMaxHarmonics){
+        cout<<"EventPlaneMaker::setN() n = "<<N<<" is above the "<<TTreeEvent::kMaxHarmonics<<" harmonics stored in TTreeEvent, using "<<TTreeEvent::kMaxHarmonics<<endl;
+        N = TTreeEvent::kMaxHarmonics;
+    }
+}
+
+void EventPlaneMaker::setMaxHarmonic(unsigned int k){
+    maxHarmonic = k;
+    if(maxHarmonic > (unsigned int)TTreeEvent::kMaxHarmonics){
+        cout<<"EventPlaneMaker::setMaxHarmonic() k = "<<maxHarmonic<<" is above the "<<TTreeEvent::kMaxHarmonics<<" harmonics stored in TTreeEvent, using "<<TTreeEvent::kMaxHarmonics<<endl;
+        maxHarmonic = TTreeEvent::kMaxHarmonics;
+    }
+}
+
 EventPlaneMaker::~EventPlaneMaker(){
 
 }
 
 void EventPlaneMaker::clear(){
-    trackVector.clear();
-    leadingJet.reset();
-    subLeadingJet.reset();
+    exclusionGrid.clear();
 }
 
 void EventPlaneMaker::finish(){
@@ -55,6 +72,34 @@ void EventPlaneMaker::finish(){
     outFile->Close();
 }
 
+EventPlaneMaker* EventPlaneMaker::clone() const{
+    EventPlaneMaker* ep = new EventPlaneMaker(N);
+    ep->removeLeadingEtaStrip = removeLeadingEtaStrip;
+    ep->removeSubLeadingEtaStrip = removeSubLeadingEtaStrip;
+    ep->removeLeadingEtaPhiCone = removeLeadingEtaPhiCone;
+    ep->removeSubLeadingEtaPhiCone = removeSubLeadingEtaPhiCone;
+    ep->maxTrackPt = maxTrackPt;
+    ep->maxHarmonic = maxHarmonic;
+    ep->excludeJetPtMin = excludeJetPtMin;
+    ep->exclusionGrid = exclusionGrid;
+    ep->calibrator = calibrator;
+    for(auto& p : epProf){
+        TProfile2D* prof = static_cast<TProfile2D*>(p.second->Clone());
+        prof->SetDirectory(nullptr);
+        ep->epProf[p.first] = prof;
+    }
+    ep->resolveProfiles();
+    return ep;
+}
+
+void EventPlaneMaker::merge(const EventPlaneMaker& other){
+    for(auto& p : epProf){
+        auto it = other.epProf.find(p.first);
+        if(it == other.epProf.end()) continue;
+        p.second->Add(it->second);
+    }
+}
+
 void EventPlaneMaker::declareTProfile2Ds(string var1name, int nVar1Bins, const double* var1Bins, string var2name, int nVar2Bins, const double* var2Bins){
     string hname, htitle;
     for(auto& epVar : epVars){
@@ -63,14 +108,71 @@ void EventPlaneMaker::declareTProfile2Ds(string var1name, int nVar1Bins, const d
         epProf[hname]   = new TProfile2D(hname.c_str(), htitle.c_str(), nVar1Bins, var1Bins, nVar2Bins, var2Bins);
         epProf[hname]->Sumw2();
     }
+    resolveProfiles();
+}
+
+void EventPlaneMaker::resolveProfiles(){
+    auto find = [this](string name) -> TProfile2D* {
+        auto it = epProf.find(name);
+        return (it == epProf.end()) ? nullptr : it->second;
+    };
+    pQx = find("p2Qx_raw");
+    pQy = find("p2Qy_raw");
+    pQx_A = find("p2Qx_A_raw");
+    pQy_A = find("p2Qy_A_raw");
+    pQx_B = find("p2Qx_B_raw");
+    pQy_B = find("p2Qy_B_raw");
+    eventProfs.clear();
+    for(auto& epVar : epVars){
+        if(epVar.first.find("Q") == 0) continue;
+        TProfile2D* prof = find("p2" + epVar.first + "_raw");
+        if(prof) eventProfs.push_back(make_pair(epVar.second, prof));
+    }
 }
 
 void EventPlaneMaker::setLeadingJet(JetVector& jet){
-    leadingJet.reset(new JetVector(jet));
+    if(removeLeadingEtaStrip) exclusionGrid.addStrip(jet.eta(), jet.getRadius());
+    if(removeLeadingEtaPhiCone) exclusionGrid.addCone(jet.eta(), jet.phi(), jet.getRadius());
 }
 
 void EventPlaneMaker::setSubLeadingJet(JetVector& jet){
-    subLeadingJet.reset(new JetVector(jet));
+    if(removeSubLeadingEtaStrip) exclusionGrid.addStrip(jet.eta(), jet.getRadius());
+    if(removeSubLeadingEtaPhiCone) exclusionGrid.addCone(jet.eta(), jet.phi(), jet.getRadius());
+}
+
+void EventPlaneMaker::setJets(vector<JetVector>& jets){
+    if(jets.empty()) return;
+    setLeadingJet(jets[0]);
+    if(jets.size() > 1) setSubLeadingJet(jets[1]);
+    if(excludeJetPtMin < 0) return;
+    for(size_t i = 1; i < jets.size(); i++){
+        if(jets[i].pt() > excludeJetPtMin) exclusionGrid.addCone(jets[i].eta(), jets[i].phi(), jets[i].getRadius());
+    }
+}
+
+void EventPlaneMaker::selectTracks(){
+    epPt.clear();
+    epEta.clear();
+    epCos.clear();
+    epSin.clear();
+    size_t nTracks = tracks ? tracks->size() : 0;
+    for(size_t itrk = 0; itrk < nTracks; itrk++){
+        if(!tracks->hasBit(itrk, TrackBuffer::kPrimary)) continue;
+        double trkPt = tracks->pt[itrk];
+        if(trkPt > maxTrackPt || trkPt <= 0) continue;
+        double trkEta = tracks->eta[itrk];
+
+        if(!exclusionGrid.empty()){
+            double trkPhi = tracks->phi[itrk];
+            if(trkPhi < 0) trkPhi += 2*TMath::Pi();
+            if(exclusionGrid.isExcluded(trkEta, trkPhi)) continue;
+        }
+
+        epPt.push_back(trkPt);
+        epEta.push_back(trkEta);
+        epCos.push_back(tracks->px[itrk]/trkPt);
+        epSin.push_back(tracks->py[itrk]/trkPt);
+    }
 }
 
 void EventPlaneMaker::calculateEventPlane(double var1, double var2, double weight){
@@ -88,63 +190,71 @@ void EventPlaneMaker::calculateEventPlane(double var1, double var2, double weigh
 
     //cout<<"EventPlaneMaker::calculateEventPlane()"<<N<<endl;
 
-    for(auto& trk : trackVector){
-        if(!trk.isPrimary()) continue;
-        TVector3 mom = trk.pMom();
-        double trkPt = mom.Perp();
-        //cout<<"trkPt = "<<trkPt<<endl;
-        if(trkPt > maxTrackPt) continue;
-        double trkEta = mom.Eta();
-        double trkPhi = mom.Phi();
-        if(trkPhi < 0) trkPhi += 2*TMath::Pi();
-
-        if(leadingJet){
-            if(removeLeadingEtaStrip){
-                if(fabs(trkEta - leadingJet->eta()) < leadingJet->getRadius()) continue;
-            }
-            if(removeLeadingEtaPhiCone){
-                if(leadingJet->getDeltaR(trkEta, trkPhi) < leadingJet->getRadius()) continue;
-            }
-        }
+    selectTracks();
 
-        if(subLeadingJet){
-            if(removeSubLeadingEtaStrip){
-                if(fabs(trkEta - subLeadingJet->eta()) < subLeadingJet->getRadius()) continue;
-            }
-            if(removeSubLeadingEtaPhiCone){
-                if(subLeadingJet->getDeltaR(trkEta, trkPhi) < subLeadingJet->getRadius()) continue;
-            }
-        }
+    //the in-memory calibration pass must not enter the raw profiles twice
+    bool fillProfiles = !(calibrator && calibrator->isAccumulating());
+
+    unsigned int nHarmonics = getNHarmonics();
+    Qx_n.assign(nHarmonics, 0); Qy_n.assign(nHarmonics, 0);
+    Qx_A_n.assign(nHarmonics, 0); Qy_A_n.assign(nHarmonics, 0);
+    Qx_B_n.assign(nHarmonics, 0); Qy_B_n.assign(nHarmonics, 0);
 
-        double x = trkPt * cos(N * trkPhi);
-        double y = trkPt * sin(N * trkPhi);
+    for(size_t i = 0; i < epPt.size(); i++){
+        double trkPt = epPt[i];
+        bool isA = epEta[i] > 0;
+        double* Qx_sub = isA ? Qx_A_n.data() : Qx_B_n.data();
+        double* Qy_sub = isA ? Qy_A_n.data() : Qy_B_n.data();
 
-        epProf["p2Qx_raw"]->Fill(var1, var2, x, weight);
-        epProf["p2Qy_raw"]->Fill(var1, var2, y, weight);
+        //cos(n phi), sin(n phi) for n = 1..nHarmonics by repeated complex multiplication
+        //of the unit vector, so no trig calls are needed for any harmonic
+        double c = epCos[i], s = epSin[i];
+        double cn = 1, sn = 0;
+        double x = 0, y = 0;
+        for(unsigned int n = 1; n <= nHarmonics; n++){
+            double t = cn*c - sn*s;
+            sn = sn*c + cn*s;
+            cn = t;
+            double qx = trkPt * cn;
+            double qy = trkPt * sn;
+            Qx_n[n-1] += qx;
+            Qy_n[n-1] += qy;
+            Qx_sub[n-1] += qx;
+            Qy_sub[n-1] += qy;
+            if(n == N){x = qx; y = qy;}
+        }
+
+        if(fillProfiles && pQx) pQx->Fill(var1, var2, x, weight);
+        if(fillProfiles && pQy) pQy->Fill(var1, var2, y, weight);
 
-        Qx_raw += x;
-        Qy_raw += y;
         eventWeight += trkPt;
         eventMultiplicity++;
 
-        if(trkEta > 0){
-            epProf["p2Qx_A_raw"]->Fill(var1, var2, x, weight);
-            epProf["p2Qy_A_raw"]->Fill(var1, var2, y, weight);
-            Qx_raw_A += x;
-            Qy_raw_A += y;
+        if(isA){
+            if(fillProfiles && pQx_A) pQx_A->Fill(var1, var2, x, weight);
+            if(fillProfiles && pQy_A) pQy_A->Fill(var1, var2, y, weight);
             subEventWeight_A += trkPt;
             subEventMultiplicity_A++;
         }
         else{
-            epProf["p2Qx_B_raw"]->Fill(var1, var2, x, weight);
-            epProf["p2Qy_B_raw"]->Fill(var1, var2, y, weight);
-            Qx_raw_B += x;
-            Qy_raw_B += y;
+            if(fillProfiles && pQx_B) pQx_B->Fill(var1, var2, x, weight);
+            if(fillProfiles && pQy_B) pQy_B->Fill(var1, var2, y, weight);
             subEventWeight_B += trkPt;
             subEventMultiplicity_B++;
         }
     }
 
+    psi_n.resize(nHarmonics); psi_A_n.resize(nHarmonics); psi_B_n.resize(nHarmonics);
+    for(unsigned int n = 1; n <= nHarmonics; n++){
+        psi_n[n-1] = atan2(Qy_n[n-1], Qx_n[n-1]) / (double)n;
+        psi_A_n[n-1] = atan2(Qy_A_n[n-1], Qx_A_n[n-1]) / (double)n;
+        psi_B_n[n-1] = atan2(Qy_B_n[n-1], Qx_B_n[n-1]) / (double)n;
+    }
+
+    Qx_raw = Qx_n[N-1]; Qy_raw = Qy_n[N-1];
+    Qx_raw_A = Qx_A_n[N-1]; Qy_raw_A = Qy_A_n[N-1];
+    Qx_raw_B = Qx_B_n[N-1]; Qy_raw_B = Qy_B_n[N-1];
+
     psi_raw = atan2(Qy_raw, Qx_raw) / (float)N;
     psi_raw_A = atan2(Qy_raw_A, Qx_raw_A) / (float)N;
     psi_raw_B = atan2(Qy_raw_B, Qx_raw_B) / (float)N;
@@ -159,10 +269,36 @@ void EventPlaneMaker::calculateEventPlane(double var1, double var2, double weigh
     if(psi_raw_B >  0.5*TMath::Pi()) psi_raw_B -= TMath::Pi();
     //cout<<"EventPlaneMaker::calculateEventPlane() psi_raw = "<<psi_raw<<endl;
 
-    for(auto& epVar : epVars){
-        string hname = "p2"+epVar.first+"_raw";
-        if(hname.find("p2Q") != string::npos)continue;
-        assert(epProf.find(hname) != epProf.end());
-        epProf[hname]->Fill(var1, var2, epVar.second(*this), weight);
+    if(calibrator) calibrate(var1, var2);
+
+    if(!fillProfiles) return;
+    for(auto& p : eventProfs){
+        p.second->Fill(var1, var2, p.first(*this), weight);
+    }
+}
+
+bool EventPlaneMaker::isCalibrated(){
+    return calibrator && calibrator->isReady();
+}
+
+void EventPlaneMaker::calibrate(double var1, double var2){
+    nCorrHarmonics = getNHarmonics();
+    Qx_corr.resize(3*nCorrHarmonics);
+    Qy_corr.resize(3*nCorrHarmonics);
+    psi_corr.resize(3*nCorrHarmonics);
+    for(unsigned int n = 0; n < nCorrHarmonics; n++){
+        Qx_corr[n] = Qx_n[n];
+        Qy_corr[n] = Qy_n[n];
+        Qx_corr[nCorrHarmonics + n] = Qx_A_n[n];
+        Qy_corr[nCorrHarmonics + n] = Qy_A_n[n];
+        Qx_corr[2*nCorrHarmonics + n] = Qx_B_n[n];
+        Qy_corr[2*nCorrHarmonics + n] = Qy_B_n[n];
+    }
+    unsigned int mult[3] = {eventMultiplicity, subEventMultiplicity_A, subEventMultiplicity_B};
+    if(calibrator->isAccumulating()){
+        calibrator->record(runId, var1, var2, nCorrHarmonics, Qx_corr.data(), Qy_corr.data(), mult);
+    }
+    else if(calibrator->isReady()){
+        calibrator->apply(runId, var1, var2, nCorrHarmonics, Qx_corr.data(), Qy_corr.data(), mult, psi_corr.data());
     }
 }
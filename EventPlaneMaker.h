@@ -5,11 +5,12 @@
 #include <vector>
 #include <memory>
 #include <string>
-#include <functional>
 
-#include "StPicoTrack.h"
+#include "TrackBuffer.h"
+#include "JetExclusionGrid.h"
 
 class JetVector;
+class EventPlaneCalibrator;
 class TProfile2D;
 class TFile;
 
@@ -20,10 +21,13 @@ public:
 
     void clear();
     void finish();
+    EventPlaneMaker* clone() const;
+    void merge(const EventPlaneMaker& other);
     void declareTProfile2Ds(std::string var1name, int nVar1Bins, const double* var1Bins, std::string var2name, int nVar2Bins, const double* var2Bins);
-    void addTrack(StPicoTrack& trk){trackVector.emplace_back(trk);}
+    void setTrackBuffer(const TrackBuffer* buffer){tracks = buffer;}
     void calculateEventPlane(double v1, double v2, double weight = 1.0);
 
+    //Harmonic N, kept for the single-plane API
     double getQx(){return Qx_raw;}
     double getQy(){return Qy_raw;}
     double getQx_A(){return Qx_raw_A;}
@@ -45,12 +49,47 @@ public:
 
     double getEPResolution(unsigned int m){return cos(m * (psi_raw_A - psi_raw_B));}
 
-    void setN(unsigned int n){N = n;}
+    //Any harmonic n = 1..getNHarmonics() from the same pass over the tracks
+    unsigned int getNHarmonics(){return (maxHarmonic > N) ? maxHarmonic : N;}
+    double getQx(unsigned int n){return Qx_n[n-1];}
+    double getQy(unsigned int n){return Qy_n[n-1];}
+    double getQx_A(unsigned int n){return Qx_A_n[n-1];}
+    double getQy_A(unsigned int n){return Qy_A_n[n-1];}
+    double getQx_B(unsigned int n){return Qx_B_n[n-1];}
+    double getQy_B(unsigned int n){return Qy_B_n[n-1];}
+    double getPsi(unsigned int n){return psi_n[n-1];}
+    double getPsi_A(unsigned int n){return psi_A_n[n-1];}
+    double getPsi_B(unsigned int n){return psi_B_n[n-1];}
+    double getEPResolution(unsigned int m, unsigned int n){return cos(m * (psi_A_n[n-1] - psi_B_n[n-1]));}
+
+    //Recentered Q-vectors and flattened planes, valid when isCalibrated()
+    bool isCalibrated();
+    double getQx_corr(unsigned int n){return Qx_corr[n-1];}
+    double getQy_corr(unsigned int n){return Qy_corr[n-1];}
+    double getQx_A_corr(unsigned int n){return Qx_corr[nCorrHarmonics + n-1];}
+    double getQy_A_corr(unsigned int n){return Qy_corr[nCorrHarmonics + n-1];}
+    double getQx_B_corr(unsigned int n){return Qx_corr[2*nCorrHarmonics + n-1];}
+    double getQy_B_corr(unsigned int n){return Qy_corr[2*nCorrHarmonics + n-1];}
+    double getPsi_corr(unsigned int n){return psi_corr[n-1];}
+    double getPsi_A_corr(unsigned int n){return psi_corr[nCorrHarmonics + n-1];}
+    double getPsi_B_corr(unsigned int n){return psi_corr[2*nCorrHarmonics + n-1];}
+
+    unsigned int getN(){return N;}
+    //Both are limited to the TTreeEvent::kMaxHarmonics planes stored per event
+    void setN(unsigned int n);
+    void setMaxHarmonic(unsigned int k);
     void setMaxTrackPt(double pt){maxTrackPt = pt;}
     void setOutFileName(std::string name){outFileName = name;}
+    void setRunId(int run){runId = run;}
+    void setCalibrator(std::shared_ptr<EventPlaneCalibrator> cal){calibrator = cal;}
 
     void setLeadingJet(JetVector& jet);
     void setSubLeadingJet(JetVector& jet);
+    //pt-ordered jets: leading/subleading as configured below, further jets above the threshold as eta-phi cones
+    void setJets(std::vector<JetVector>& jets);
+    void setExcludeJetsAbovePt(double pt){excludeJetPtMin = pt;}
+    void setExcludeAllJets(bool exclude){excludeJetPtMin = exclude ? 0.0 : -1.0;}
+    void setExclusionGrid(int nEtaCells, int nPhiCells, double etaMax){exclusionGrid = JetExclusionGrid(nEtaCells, nPhiCells, etaMax);}
 
     void setRemoveLeadingEtaStrip(bool remove){removeLeadingEtaStrip = remove; removeLeadingEtaPhiCone = !remove;}
     void setRemoveSubLeadingEtaStrip(bool remove){removeSubLeadingEtaStrip = remove; removeSubLeadingEtaPhiCone = !remove;}
@@ -68,12 +107,33 @@ private:
     std::string outFileName = "";
     TFile* outFile = nullptr;
 
-    std::vector<StPicoTrack> trackVector;
+    const TrackBuffer* tracks = nullptr;
 
-    std::unique_ptr<JetVector> leadingJet;
-    std::unique_ptr<JetVector> subLeadingJet;
+    //Compact per-event record of the tracks entering the Q-vectors, reused between events
+    std::vector<double> epPt;
+    std::vector<double> epEta;
+    std::vector<double> epCos;
+    std::vector<double> epSin;
+
+    void selectTracks();
+    void resolveProfiles();
+
+    double excludeJetPtMin = -1.0;
+    JetExclusionGrid exclusionGrid;
 
     unsigned int N = 2;
+    unsigned int maxHarmonic = 0;
+
+    std::vector<double> Qx_n, Qy_n;
+    std::vector<double> Qx_A_n, Qy_A_n;
+    std::vector<double> Qx_B_n, Qy_B_n;
+    std::vector<double> psi_n, psi_A_n, psi_B_n;
+
+    int runId = -1;
+    std::shared_ptr<EventPlaneCalibrator> calibrator;
+    unsigned int nCorrHarmonics = 0;
+    std::vector<double> Qx_corr, Qy_corr, psi_corr;
+    void calibrate(double var1, double var2);
 
     double Qx_raw = 0, Qy_raw = 0;
     double Qx_raw_A = 0, Qy_raw_A = 0;
@@ -93,7 +153,16 @@ private:
 
     std::map<std::string, TProfile2D*> epProf;
 
-    static std::map<std::string, std::function<double(EventPlaneMaker&)>> epVars;
+    TProfile2D* pQx = nullptr;
+    TProfile2D* pQy = nullptr;
+    TProfile2D* pQx_A = nullptr;
+    TProfile2D* pQy_A = nullptr;
+    TProfile2D* pQx_B = nullptr;
+    TProfile2D* pQy_B = nullptr;
+
+    typedef double (*EPVar)(EventPlaneMaker&);
+    static std::map<std::string, EPVar> epVars;
+    std::vector<std::pair<EPVar, TProfile2D*>> eventProfs;
     
 };
 
@@ -0,0 +1,208 @@
+#define FlowCumulantMaker_cxx
+
+#include "FlowCumulantMaker.h"
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TProfile.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+FlowCumulantMaker::FlowCumulantMaker(){
+    cout<<"FlowCumulantMaker::FlowCumulantMaker()"<<endl;
+}
+
+FlowCumulantMaker::~FlowCumulantMaker(){
+
+}
+
+void FlowCumulantMaker::finish(){
+    if(outFileName == "") outFileName = "FlowCumulantMaker.root";
+    outFile = new TFile(outFileName.c_str(), "RECREATE");
+    outFile->cd();
+    for(auto& p : flowProf){
+        p.second->Write();
+    }
+    //v_n{2} = sqrt(c_n{2}), v_n{4} = (-c_n{4})^(1/4) with c_n{4} = <<4>> - 2<<2>>^2, from the merged profiles
+    for(auto& h : harmonicProfs){
+        const TAxis* axis = h.c2->GetXaxis();
+        vector<double> edges;
+        for(int i = 1; i <= axis->GetNbins(); i++) edges.push_back(axis->GetBinLowEdge(i));
+        edges.push_back(axis->GetBinUpEdge(axis->GetNbins()));
+        string n = to_string(h.n);
+        TH1D* hV2 = new TH1D(("hV" + n + "_2").c_str(), ("v_{" + n + "}{2}").c_str(), edges.size() - 1, edges.data());
+        TH1D* hV4 = new TH1D(("hV" + n + "_4").c_str(), ("v_{" + n + "}{4}").c_str(), edges.size() - 1, edges.data());
+        for(int i = 1; i <= axis->GetNbins(); i++){
+            double c2 = h.c2->GetBinContent(i);
+            double c4 = h.c4->GetBinContent(i) - 2*c2*c2;
+            if(c2 > 0) hV2->SetBinContent(i, sqrt(c2));
+            if(c4 < 0) hV4->SetBinContent(i, pow(-c4, 0.25));
+        }
+        hV2->Write();
+        hV4->Write();
+    }
+    outFile->Write();
+    outFile->Close();
+}
+
+FlowCumulantMaker* FlowCumulantMaker::clone() const{
+    FlowCumulantMaker* fm = new FlowCumulantMaker();
+    fm->minTrackPt = minTrackPt;
+    fm->maxTrackPt = maxTrackPt;
+    fm->harmonics = harmonics;
+    fm->etaGaps = etaGaps;
+    for(auto& p : flowProf){
+        TProfile* prof = static_cast<TProfile*>(p.second->Clone());
+        prof->SetDirectory(nullptr);
+        fm->flowProf[p.first] = prof;
+    }
+    fm->resolveProfiles();
+    return fm;
+}
+
+void FlowCumulantMaker::merge(const FlowCumulantMaker& other){
+    for(auto& p : flowProf){
+        auto it = other.flowProf.find(p.first);
+        if(it == other.flowProf.end()) continue;
+        p.second->Add(it->second);
+    }
+}
+
+void FlowCumulantMaker::declareProfiles(int nCentBins, const double* centBins){
+    auto book = [&](string hname, string htitle){
+        flowProf[hname] = new TProfile(hname.c_str(), htitle.c_str(), nCentBins, centBins);
+        flowProf[hname]->Sumw2();
+    };
+    for(unsigned int n : harmonics){
+        string sn = to_string(n);
+        book("pC" + sn + "_2", "<<2>>_{" + sn + "} vs centrality");
+        book("pC" + sn + "_4", "<<4>>_{" + sn + "} vs centrality");
+        book("pC" + sn + "_24", "<<2><4>>_{" + sn + "} vs centrality");
+        for(double gap : etaGaps){
+            string sg = to_string((int)lround(gap*10));
+            book("pC" + sn + "_2_Gap" + sg, "<<2>>_{" + sn + "} |#Delta#eta| > " + to_string(gap) + " vs centrality");
+            book("pC" + sn + "_4_2Sub_Gap" + sg, "<<4>>_{" + sn + "} 2-subevent |#Delta#eta| > " + to_string(gap) + " vs centrality");
+        }
+    }
+    resolveProfiles();
+}
+
+void FlowCumulantMaker::resolveProfiles(){
+    harmonicProfs.clear();
+    maxQHarmonic = 0;
+    for(unsigned int n : harmonics){
+        string sn = to_string(n);
+        auto c2 = flowProf.find("pC" + sn + "_2");
+        auto c4 = flowProf.find("pC" + sn + "_4");
+        auto c24 = flowProf.find("pC" + sn + "_24");
+        if(c2 == flowProf.end() || c4 == flowProf.end() || c24 == flowProf.end()) continue;
+        HarmonicProfiles h = {n, c2->second, c4->second, c24->second, {}, {}};
+        for(double gap : etaGaps){
+            string sg = to_string((int)lround(gap*10));
+            h.c2Gap.push_back(flowProf["pC" + sn + "_2_Gap" + sg]);
+            h.c4Gap.push_back(flowProf["pC" + sn + "_4_2Sub_Gap" + sg]);
+        }
+        harmonicProfs.push_back(h);
+        maxQHarmonic = max(maxQHarmonic, 2*(int)n);
+    }
+}
+
+void FlowCumulantMaker::fillQ(){
+    size_t stride = (maxQHarmonic + 1)*(maxPower + 1);
+    size_t nGaps = etaGaps.size();
+    Q.assign(stride, Complex(0, 0));
+    Q_A.assign(stride*nGaps, Complex(0, 0));
+    Q_B.assign(stride*nGaps, Complex(0, 0));
+
+    size_t nTracks = tracks ? tracks->size() : 0;
+    for(size_t itrk = 0; itrk < nTracks; itrk++){
+        if(!tracks->hasBit(itrk, TrackBuffer::kPrimary)) continue;
+        double trkPt = tracks->pt[itrk];
+        if(trkPt < minTrackPt || trkPt > maxTrackPt || trkPt <= 0) continue;
+        double trkEta = tracks->eta[itrk];
+
+        //unit weights, efficiency/acceptance weights would enter here
+        double w = 1.0;
+        double wp[maxPower + 1];
+        wp[0] = 1;
+        for(int p = 1; p <= maxPower; p++) wp[p] = wp[p-1]*w;
+
+        //exp(i h phi) for h = 0..maxQHarmonic by recurrence from the unit vector
+        Complex u(tracks->px[itrk]/trkPt, tracks->py[itrk]/trkPt);
+        Complex e(1, 0);
+        for(int h = 0; h <= maxQHarmonic; h++){
+            for(int p = 0; p <= maxPower; p++){
+                Complex term = wp[p]*e;
+                size_t i = h*(maxPower + 1) + p;
+                Q[i] += term;
+                for(size_t ig = 0; ig < nGaps; ig++){
+                    if(trkEta > 0.5*etaGaps[ig]) Q_A[ig*stride + i] += term;
+                    else if(trkEta < -0.5*etaGaps[ig]) Q_B[ig*stride + i] += term;
+                }
+            }
+            e *= u;
+        }
+    }
+}
+
+FlowCumulantMaker::Complex FlowCumulantMaker::getQ(const Complex* q, int n, int p) const{
+    return (n >= 0) ? q[n*(maxPower + 1) + p] : conj(q[-n*(maxPower + 1) + p]);
+}
+
+FlowCumulantMaker::Complex FlowCumulantMaker::two(const Complex* q, int n1, int n2) const{
+    return getQ(q, n1, 1)*getQ(q, n2, 1) - getQ(q, n1 + n2, 2);
+}
+
+FlowCumulantMaker::Complex FlowCumulantMaker::four(const Complex* q, int n1, int n2, int n3, int n4) const{
+    //generic framework expression for the weighted 4-particle correlator
+    return getQ(q, n1, 1)*getQ(q, n2, 1)*getQ(q, n3, 1)*getQ(q, n4, 1)
+        - getQ(q, n1 + n2, 2)*getQ(q, n3, 1)*getQ(q, n4, 1)
+        - getQ(q, n2, 1)*getQ(q, n1 + n3, 2)*getQ(q, n4, 1)
+        - getQ(q, n1, 1)*getQ(q, n2 + n3, 2)*getQ(q, n4, 1)
+        + 2.0*getQ(q, n1 + n2 + n3, 3)*getQ(q, n4, 1)
+        - getQ(q, n2, 1)*getQ(q, n3, 1)*getQ(q, n1 + n4, 2)
+        + getQ(q, n2 + n3, 2)*getQ(q, n1 + n4, 2)
+        - getQ(q, n1, 1)*getQ(q, n3, 1)*getQ(q, n2 + n4, 2)
+        + getQ(q, n1 + n3, 2)*getQ(q, n2 + n4, 2)
+        + 2.0*getQ(q, n3, 1)*getQ(q, n1 + n2 + n4, 3)
+        - getQ(q, n1, 1)*getQ(q, n2, 1)*getQ(q, n3 + n4, 2)
+        + getQ(q, n1 + n2, 2)*getQ(q, n3 + n4, 2)
+        + 2.0*getQ(q, n2, 1)*getQ(q, n1 + n3 + n4, 3)
+        + 2.0*getQ(q, n1, 1)*getQ(q, n2 + n3 + n4, 3)
+        - 6.0*getQ(q, n1 + n2 + n3 + n4, 4);
+}
+
+void FlowCumulantMaker::calculate(double centrality, double weight){
+    if(harmonicProfs.empty()) return;
+    fillQ();
+
+    size_t stride = (maxQHarmonic + 1)*(maxPower + 1);
+    double W2 = two(Q.data(), 0, 0).real();
+    double W4 = four(Q.data(), 0, 0, 0, 0).real();
+    for(auto& h : harmonicProfs){
+        int n = h.n;
+        double c2 = 0;
+        if(W2 > 0){
+            c2 = two(Q.data(), n, -n).real()/W2;
+            h.c2->Fill(centrality, c2, W2*weight);
+        }
+        if(W4 > 0){
+            double c4 = four(Q.data(), n, n, -n, -n).real()/W4;
+            h.c4->Fill(centrality, c4, W4*weight);
+            h.c24->Fill(centrality, c2*c4, W2*W4*weight);
+        }
+        for(size_t ig = 0; ig < etaGaps.size(); ig++){
+            const Complex* qA = &Q_A[ig*stride];
+            const Complex* qB = &Q_B[ig*stride];
+            //no track is shared between the sides, so no autocorrelation terms
+            double W2Gap = (getQ(qA, 0, 1)*getQ(qB, 0, 1)).real();
+            if(W2Gap > 0) h.c2Gap[ig]->Fill(centrality, (getQ(qA, n, 1)*getQ(qB, -n, 1)).real()/W2Gap, W2Gap*weight);
+            double W4Gap = (two(qA, 0, 0)*two(qB, 0, 0)).real();
+            if(W4Gap > 0) h.c4Gap[ig]->Fill(centrality, (two(qA, n, n)*two(qB, -n, -n)).real()/W4Gap, W4Gap*weight);
+        }
+    }
+}
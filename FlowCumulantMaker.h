@@ -0,0 +1,76 @@
+#ifndef FlowCumulantMaker_H
+#define FlowCumulantMaker_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <complex>
+
+#include "TrackBuffer.h"
+
+class TProfile;
+class TFile;
+
+//Multi-particle cumulants in the generic framework: the weighted Q-vectors
+//Q_{n,p} = sum_i w_i^p exp(i n phi_i) are built once per event, so <2> and <4>
+//(and their eta-gap / two-subevent variants) cost O(M) instead of O(M^2)/O(M^4).
+class FlowCumulantMaker {
+public:
+    FlowCumulantMaker();
+    virtual ~FlowCumulantMaker();
+
+    void finish();
+    FlowCumulantMaker* clone() const;
+    void merge(const FlowCumulantMaker& other);
+    void declareProfiles(int nCentBins, const double* centBins);
+    void calculate(double centrality, double weight = 1.0);
+
+    void setTrackBuffer(const TrackBuffer* buffer){tracks = buffer;}
+    void setHarmonics(std::vector<unsigned int> n){harmonics = n;}
+    void addEtaGap(double gap){etaGaps.push_back(gap);}
+    void setPtRange(double min, double max){minTrackPt = min; maxTrackPt = max;}
+    void setOutFileName(std::string name){outFileName = name;}
+
+    bool hasProfiles(){return !flowProf.empty();}
+
+private:
+    typedef std::complex<double> Complex;
+    static const int maxPower = 4;
+
+    double minTrackPt = 0.2;
+    double maxTrackPt = 2.0;
+    std::vector<unsigned int> harmonics = {2, 3};
+    std::vector<double> etaGaps = {1.0};
+
+    std::string outFileName = "";
+    TFile* outFile = nullptr;
+
+    const TrackBuffer* tracks = nullptr;
+
+    //Q[h*(maxPower+1) + p] for harmonics h = 0..maxQHarmonic, Q_A/Q_B hold one such block per eta gap
+    int maxQHarmonic = 0;
+    std::vector<Complex> Q;
+    std::vector<Complex> Q_A;
+    std::vector<Complex> Q_B;
+
+    void fillQ();
+    Complex getQ(const Complex* q, int n, int p) const;
+    Complex two(const Complex* q, int n1, int n2) const;
+    Complex four(const Complex* q, int n1, int n2, int n3, int n4) const;
+
+    std::map<std::string, TProfile*> flowProf;
+
+    //Handles resolved at declaration, one entry per harmonic
+    struct HarmonicProfiles {
+        unsigned int n;
+        TProfile* c2;
+        TProfile* c4;
+        TProfile* c24;
+        std::vector<TProfile*> c2Gap;
+        std::vector<TProfile*> c4Gap;
+    };
+    std::vector<HarmonicProfiles> harmonicProfs;
+    void resolveProfiles();
+};
+
+#endif
@@ -0,0 +1,51 @@
+#define HadronicCorrection_cxx
+
+#include "HadronicCorrection.h"
+#include "BEMCGeometry.h"
+
+#include <cassert>
+
+using namespace std;
+
+HadronicCorrection::HadronicCorrection(Scheme s, double f){
+    scheme = s;
+    fraction = f;
+    sumE.assign(BEMCGeometry::nRaw, 0.0);
+    nMatched.assign(BEMCGeometry::nRaw, 0);
+    touched.reserve(256);
+}
+
+const char* HadronicCorrection::getSchemeName(Scheme s){
+    switch(s){
+        case kMean: return "mean";
+        case kFull: return "full";
+        case kFraction: return "fraction";
+    }
+    return "unknown";
+}
+
+void HadronicCorrection::clear(){
+    for(int id : touched){
+        sumE[id-1] = 0;
+        nMatched[id-1] = 0;
+    }
+    touched.clear();
+}
+
+void HadronicCorrection::addTrack(int softId, double e){
+    assert(softId >= 1 && softId <= BEMCGeometry::nRaw);
+    if(nMatched[softId-1] == 0) touched.push_back(softId);
+    nMatched[softId-1]++;
+    sumE[softId-1] += e;
+}
+
+double HadronicCorrection::correct(int softId, double towerE) const {
+    unsigned int n = nMatched[softId-1];
+    if(n == 0) return towerE;
+    switch(scheme){
+        case kMean: return towerE - sumE[softId-1]/n;
+        case kFull: return towerE - sumE[softId-1];
+        case kFraction: return towerE - fraction*sumE[softId-1];
+    }
+    return towerE;
+}
@@ -0,0 +1,45 @@
+#ifndef HadronicCorrection_H
+#define HadronicCorrection_H
+
+#include <vector>
+
+//Tower-track hadronic correction keyed by BEMC soft id (1..4800): a track with
+//bemcTowerIndex() i matches tower hit itow = i. Only towers touched in the event
+//are kept in the touched list and reset by clear().
+class HadronicCorrection {
+public:
+    enum Scheme {
+        kMean = 0, //subtract the mean energy of the matched tracks
+        kFull,     //subtract the summed energy of the matched tracks
+        kFraction  //subtract fraction*(summed energy of the matched tracks)
+    };
+
+    HadronicCorrection(Scheme scheme = kMean, double fraction = 1.0);
+    virtual ~HadronicCorrection(){}
+
+    void setScheme(Scheme s){scheme = s;}
+    void setFraction(double f){fraction = f;}
+    Scheme getScheme() const {return scheme;}
+    double getFraction() const {return fraction;}
+    static const char* getSchemeName(Scheme s);
+
+    void clear();
+    void addTrack(int softId, double e);
+
+    unsigned int getNMatched(int softId) const {return nMatched[softId-1];}
+    double getMatchedE(int softId) const {return sumE[softId-1];}
+    const std::vector<int>& getTouched() const {return touched;}
+
+    //Tower energy after subtracting the matched tracks, may be negative
+    double correct(int softId, double towerE) const;
+
+private:
+    Scheme scheme = kMean;
+    double fraction = 1.0;
+
+    std::vector<double> sumE;
+    std::vector<unsigned int> nMatched;
+    std::vector<int> touched;
+};
+
+#endif
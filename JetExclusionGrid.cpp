@@ -0,0 +1,115 @@
+#define JetExclusionGrid_cxx
+
+#include "JetExclusionGrid.h"
+
+#include "TMath.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+JetExclusionGrid::JetExclusionGrid(int nEtaCells, int nPhiCells, double etaMaxGrid){
+    nEta = (nEtaCells > 0) ? nEtaCells : 1;
+    nPhi = (nPhiCells > 0) ? nPhiCells : 1;
+    etaMax = etaMaxGrid;
+    cellEta = 2*etaMax/nEta;
+    cellPhi = 2*TMath::Pi()/nPhi;
+    state.assign(nEta*nPhi, kFree);
+    regionMask.assign(nEta*nPhi, 0);
+}
+
+void JetExclusionGrid::clear(){
+    //only the cells marked in this event are reset
+    for(int idx : touched){
+        state[idx] = kFree;
+        regionMask[idx] = 0;
+    }
+    touched.clear();
+    regions.clear();
+}
+
+void JetExclusionGrid::markCell(int ieta, int iphi, bool full){
+    int idx = ieta*nPhi + iphi;
+    if(state[idx] == kFree) touched.push_back(idx);
+    if(full){
+        state[idx] = kFull;
+        return;
+    }
+    if(state[idx] == kFull) return;
+    state[idx] = kPartial;
+    regionMask[idx] |= uint64_t(1) << min<size_t>(regions.size() - 1, maxMaskedRegions);
+}
+
+void JetExclusionGrid::addStrip(double eta, double halfWidth){
+    regions.push_back({false, eta, 0, halfWidth});
+    int first = max(0, (int)floor((eta - halfWidth + etaMax)/cellEta));
+    int last = min(nEta - 1, (int)floor((eta + halfWidth + etaMax)/cellEta));
+    for(int ieta = first; ieta <= last; ieta++){
+        double e0 = -etaMax + ieta*cellEta;
+        double e1 = e0 + cellEta;
+        double nearest = max(0.0, max(e0 - eta, eta - e1));
+        if(nearest >= halfWidth) continue;
+        bool full = max(fabs(e0 - eta), fabs(e1 - eta)) < halfWidth;
+        for(int iphi = 0; iphi < nPhi; iphi++) markCell(ieta, iphi, full);
+    }
+}
+
+void JetExclusionGrid::addCone(double eta, double phi, double radius){
+    regions.push_back({true, eta, phi, radius});
+    double r2 = radius*radius;
+    int firstEta = max(0, (int)floor((eta - radius + etaMax)/cellEta));
+    int lastEta = min(nEta - 1, (int)floor((eta + radius + etaMax)/cellEta));
+    //phi cells are walked in unwrapped coordinates around the cone and folded back
+    int firstPhi = (int)floor((phi - radius)/cellPhi);
+    int lastPhi = (int)floor((phi + radius)/cellPhi);
+    for(int ieta = firstEta; ieta <= lastEta; ieta++){
+        double e0 = -etaMax + ieta*cellEta;
+        double e1 = e0 + cellEta;
+        double dEtaNear = max(0.0, max(e0 - eta, eta - e1));
+        double dEtaFar = max(fabs(e0 - eta), fabs(e1 - eta));
+        for(int k = firstPhi; k <= lastPhi; k++){
+            double p0 = k*cellPhi;
+            double p1 = p0 + cellPhi;
+            double dPhiNear = max(0.0, max(p0 - phi, phi - p1));
+            if(dEtaNear*dEtaNear + dPhiNear*dPhiNear >= r2) continue;
+            double dPhiFar = max(fabs(p0 - phi), fabs(p1 - phi));
+            int iphi = ((k % nPhi) + nPhi) % nPhi;
+            markCell(ieta, iphi, dEtaFar*dEtaFar + dPhiFar*dPhiFar < r2);
+        }
+    }
+}
+
+bool JetExclusionGrid::inside(const Region& region, double eta, double phi) const{
+    double dEta = eta - region.eta;
+    if(!region.cone) return fabs(dEta) < region.radius;
+    double dPhi = fabs(phi - region.phi);
+    if(dPhi > TMath::Pi()) dPhi = 2*TMath::Pi() - dPhi;
+    return dEta*dEta + dPhi*dPhi < region.radius*region.radius;
+}
+
+bool JetExclusionGrid::isExcluded(double eta, double phi) const{
+    if(regions.empty()) return false;
+    int ieta = (int)floor((eta + etaMax)/cellEta);
+    if(ieta < 0 || ieta >= nEta){
+        //outside the grid, test every region
+        for(auto& region : regions){
+            if(inside(region, eta, phi)) return true;
+        }
+        return false;
+    }
+    int iphi = min(nPhi - 1, max(0, (int)floor(phi/cellPhi)));
+    int idx = ieta*nPhi + iphi;
+    if(state[idx] == kFree) return false;
+    if(state[idx] == kFull) return true;
+    uint64_t mask = regionMask[idx];
+    for(unsigned int ir = 0; ir < maxMaskedRegions && ir < regions.size(); ir++){
+        if(((mask >> ir) & 1) && inside(regions[ir], eta, phi)) return true;
+    }
+    if((mask >> maxMaskedRegions) & 1){
+        for(size_t ir = maxMaskedRegions; ir < regions.size(); ir++){
+            if(inside(regions[ir], eta, phi)) return true;
+        }
+    }
+    return false;
+}
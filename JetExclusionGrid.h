@@ -0,0 +1,54 @@
+#ifndef JetExclusionGrid_H
+#define JetExclusionGrid_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Per-event eta-phi occupancy grid of excluded regions (eta strips and eta-phi cones).
+//Regions are rasterized once per event so a track is classified by a single cell
+//lookup; only tracks in cells cut by a region boundary get the exact check, and
+//only against the regions touching that cell.
+class JetExclusionGrid {
+public:
+    enum CellState : unsigned char {kFree = 0, kPartial, kFull};
+
+    JetExclusionGrid(int nEtaCells = 30, int nPhiCells = 60, double etaMax = 1.5);
+    virtual ~JetExclusionGrid(){}
+
+    void clear();
+    void addStrip(double eta, double halfWidth);
+    void addCone(double eta, double phi, double radius);
+
+    bool empty() const {return regions.empty();}
+    size_t getNRegions() const {return regions.size();}
+    //phi in [0, 2pi)
+    bool isExcluded(double eta, double phi) const;
+
+private:
+    struct Region {
+        bool cone;
+        double eta;
+        double phi;
+        double radius;
+    };
+
+    static const unsigned int maxMaskedRegions = 63;
+
+    int nEta;
+    int nPhi;
+    double etaMax;
+    double cellEta;
+    double cellPhi;
+
+    std::vector<unsigned char> state;
+    //regions overlapping a partial cell, the last bit stands for every region from maxMaskedRegions on
+    std::vector<uint64_t> regionMask;
+    std::vector<int> touched;
+    std::vector<Region> regions;
+
+    void markCell(int ieta, int iphi, bool full);
+    bool inside(const Region& region, double eta, double phi) const;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#define PerformanceMonitor_cxx
+
+#include "PerformanceMonitor.h"
+
+#include <sys/resource.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+void PerformanceMonitor::start(){
+    startTime = Clock::now();
+    running = true;
+}
+
+void PerformanceMonitor::stop(){
+    stopTime = Clock::now();
+    running = false;
+}
+
+void PerformanceMonitor::countEvent(){
+    nEvents++;
+    if(snapshotInterval > 0 && nEvents%snapshotInterval == 0) writeSnapshot();
+}
+
+void PerformanceMonitor::setSnapshotInterval(long nEv, string fileName){
+    snapshotInterval = nEv;
+    snapshotFileName = fileName;
+    if(snapshotInterval > 0 && snapshotFileName != ""){
+        ofstream out(snapshotFileName, ios::trunc);
+        if(!out) cout<<"PerformanceMonitor::setSnapshotInterval() can not open "<<snapshotFileName<<endl;
+    }
+}
+
+void PerformanceMonitor::merge(const PerformanceMonitor& other){
+    //Stage times add up to CPU time over all threads, the wall time stays ours
+    for(int i = 0; i < kNStages; i++){
+        stageTime[i] += other.stageTime[i];
+        stageCount[i] += other.stageCount[i];
+    }
+    nEvents += other.nEvents;
+    nAcceptedEvents += other.nAcceptedEvents;
+}
+
+double PerformanceMonitor::getWallTime() const {
+    Clock::time_point end = running ? Clock::now() : stopTime;
+    return chrono::duration<double>(end - startTime).count();
+}
+
+long PerformanceMonitor::getPeakRSS(){
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss/1024; //bytes on macOS
+#else
+    return usage.ru_maxrss; //kilobytes on Linux
+#endif
+}
+
+const char* PerformanceMonitor::getStageName(Stage stage){
+    static const char* names[kNStages] = {"read", "eventSelection", "trackLoop", "towerLoop", "jetLoop", "genTrackLoop", "genJetLoop", "eventPlane", "flowCumulants", "treeFill"};
+    return names[stage];
+}
+
+string PerformanceMonitor::toJSON() const {
+    double wallTime = getWallTime();
+    ostringstream json;
+    json << "{";
+    json << "\"events\": " << nEvents << ", ";
+    json << "\"acceptedEvents\": " << nAcceptedEvents << ", ";
+    json << "\"wallTime_s\": " << wallTime << ", ";
+    json << "\"eventsPerSecond\": " << ((wallTime > 0) ? nEvents/wallTime : 0) << ", ";
+    json << "\"peakRSS_kB\": " << getPeakRSS() << ", ";
+    json << "\"stages\": {";
+    for(int i = 0; i < kNStages; i++){
+        if(i > 0) json << ", ";
+        json << "\"" << getStageName(Stage(i)) << "\": {";
+        json << "\"calls\": " << stageCount[i] << ", ";
+        json << "\"time_s\": " << stageTime[i]*1e-9 << ", ";
+        json << "\"timePerCall_us\": " << ((stageCount[i] > 0) ? stageTime[i]*1e-3/stageCount[i] : 0);
+        json << "}";
+    }
+    json << "}}";
+    return json.str();
+}
+
+void PerformanceMonitor::writeJSON(string fileName) const {
+    ofstream out(fileName);
+    if(!out){
+        cout<<"PerformanceMonitor::writeJSON() can not open "<<fileName<<endl;
+        return;
+    }
+    out << toJSON() << endl;
+}
+
+void PerformanceMonitor::writeSnapshot(){
+    if(snapshotFileName == "") return;
+    ofstream out(snapshotFileName, ios::app);
+    if(out) out << toJSON() << endl;
+}
+
+void PerformanceMonitor::print() const {
+    double wallTime = getWallTime();
+    cout<<"PerformanceMonitor: "<<nEvents<<" events ("<<nAcceptedEvents<<" accepted) in "<<wallTime<<" s";
+    if(wallTime > 0) cout<<", "<<nEvents/wallTime<<" events/s";
+    cout<<", peak RSS "<<getPeakRSS()<<" kB"<<endl;
+    for(int i = 0; i < kNStages; i++){
+        if(stageCount[i] < 1) continue;
+        cout<<"  "<<getStageName(Stage(i))<<": "<<stageTime[i]*1e-9<<" s in "<<stageCount[i]<<" calls ("<<stageTime[i]*1e-3/stageCount[i]<<" us/call)"<<endl;
+    }
+}
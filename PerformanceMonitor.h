@@ -0,0 +1,73 @@
+#ifndef PerformanceMonitor_H
+#define PerformanceMonitor_H
+
+#include <chrono>
+#include <string>
+
+class PerformanceMonitor {
+public:
+    enum Stage {
+        kRead = 0,
+        kEventSelection,
+        kTrackLoop,
+        kTowerLoop,
+        kJetLoop,
+        kGenTrackLoop,
+        kGenJetLoop,
+        kEventPlane,
+        kFlowCumulants,
+        kTreeFill,
+        kNStages
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    //Adds the time spent in its scope to one stage, costs two clock reads
+    class ScopedTimer {
+    public:
+        ScopedTimer(PerformanceMonitor& mon, Stage s) : monitor(mon), stage(s), start(Clock::now()) {}
+        ~ScopedTimer(){monitor.add(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());}
+    private:
+        PerformanceMonitor& monitor;
+        Stage stage;
+        Clock::time_point start;
+    };
+
+    PerformanceMonitor(){}
+    virtual ~PerformanceMonitor(){}
+
+    void start();
+    void stop();
+    void add(Stage stage, long long ns){stageTime[stage] += ns; stageCount[stage]++;}
+    void countEvent();
+    void countAcceptedEvent(){nAcceptedEvents++;}
+    void merge(const PerformanceMonitor& other);
+
+    //Truncates fileName, snapshots of this job are then appended
+    void setSnapshotInterval(long nEv, std::string fileName);
+
+    double getWallTime() const;
+    static long getPeakRSS();
+    static const char* getStageName(Stage stage);
+
+    std::string toJSON() const;
+    void writeJSON(std::string fileName) const;
+    void print() const;
+
+private:
+    void writeSnapshot();
+
+    long long stageTime[kNStages] = {};
+    long stageCount[kNStages] = {};
+    long nEvents = 0;
+    long nAcceptedEvents = 0;
+
+    Clock::time_point startTime;
+    Clock::time_point stopTime;
+    bool running = false;
+
+    long snapshotInterval = 0;
+    std::string snapshotFileName = "";
+};
+
+#endif
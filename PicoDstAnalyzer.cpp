@@ -13,6 +13,8 @@
 #include "TTreeJet.h"
 #include "TTreeEvent.h"
 #include "EventPlaneMaker.h"
+#include "EventPlaneCalibrator.h"
+#include "FlowCumulantMaker.h"
 
 #include "JetMaker.h"
 #include "JetBackgroundMaker.h"
@@ -20,45 +22,48 @@
 
 #include "TFile.h"
 #include "TTree.h"
+#include "TChain.h"
 #include "TClonesArray.h"
+#include "TBranch.h"
+#include "TString.h"
 #include "TH1.h"
 #include "TH2.h"
 #include "TProfile.h"
 #include "TProfile2D.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TFileMerger.h"
+
+#include <thread>
+#include <algorithm>
 
 using namespace fastjet;
 
 using namespace std;
 
-map<string, function<double(JetVector&)>> PicoDstAnalyzer::jetVars = {
-    {"Pt", [](JetVector& vec){return vec.pt(); }},
-    {"Eta", [](JetVector& vec){return vec.eta(); }},
-    {"Phi", [](JetVector& vec){return vec.phi(); }},
-    {"NEF", [](JetVector& vec){return vec.getNeutralPtFraction(); }},
-    {"LeSub", [](JetVector& vec){return (vec.nChargedConstituents() > 1) ? vec.getChargedConstituent(0).perp() - vec.getChargedConstituent(1).perp() : -1; }},
-    {"PtD", [](JetVector& vec){return (vec.nChargedConstituents() > 1) ? vec.getChargedAngularity(2, 0, true) : -1; }},
-    {"Girth", [](JetVector& vec){return (vec.nChargedConstituents() > 1) ? vec.getChargedAngularity(1, 1, false) : -1;}}
-};
+constexpr double PicoDstAnalyzer::centBins9[];
+
+const char* PicoDstAnalyzer::jetObservableNames[PicoDstAnalyzer::kNJetObservables] = {"Pt", "Eta", "Phi", "NEF", "LeSub", "PtD", "Girth"};
 
-map<string, function<double(StPicoTrack*)>> PicoDstAnalyzer::trackVars = {
-    {"Pt",  [](StPicoTrack* vec){return vec->pMom().Pt(); }},
-    {"Eta", [](StPicoTrack* vec){return vec->pMom().Eta(); }},
-    {"Phi", [](StPicoTrack* vec){return vec->pMom().Phi(); }},
-    {"Charge", [](StPicoTrack* vec){return vec->charge(); }}
+map<string, PicoDstAnalyzer::TrackVar> PicoDstAnalyzer::trackVars = {
+    {"Pt",  [](const TrackBuffer& buf, size_t i){return buf.pt[i]; }},
+    {"Eta", [](const TrackBuffer& buf, size_t i){return buf.eta[i]; }},
+    {"Phi", [](const TrackBuffer& buf, size_t i){return buf.phi[i]; }},
+    {"Charge", [](const TrackBuffer& buf, size_t i) -> double {return buf.charge[i]; }}
 };
 
-map<string, function<double(StPicoMcTrack*)>> PicoDstAnalyzer::genTrackVars = {
+map<string, PicoDstAnalyzer::GenTrackVar> PicoDstAnalyzer::genTrackVars = {
     {"Pt",  [](StPicoMcTrack* vec){return vec->fourMomentum().Pt(); }},
     {"Eta", [](StPicoMcTrack* vec){return vec->fourMomentum().Eta(); }},
     {"Phi", [](StPicoMcTrack* vec){return vec->fourMomentum().Phi(); }},
     {"E", [](StPicoMcTrack* vec){return vec->fourMomentum().E(); }},
-    {"Charge", [](StPicoMcTrack* vec){return vec->charge(); }}
+    {"Charge", [](StPicoMcTrack* vec) -> double {return vec->charge(); }}
 };
 
-map<string, function<double(double, TVector3&)>> PicoDstAnalyzer::towerVars = {
-    {"Et",  [](double Et, TVector3& vec){return Et; }},
-    {"Eta", [](double Et, TVector3& vec){return vec.Eta(); }},
-    {"Phi", [](double Et, TVector3& vec){return vec.Phi(); }}
+map<string, PicoDstAnalyzer::TowerVar> PicoDstAnalyzer::towerVars = {
+    {"Et",  [](double Et, double eta, double phi){return Et; }},
+    {"Eta", [](double Et, double eta, double phi){return eta; }},
+    {"Phi", [](double Et, double eta, double phi){return phi; }}
 };
 
 
@@ -69,11 +74,14 @@ PicoDstAnalyzer::PicoDstAnalyzer(string infile, long nEv, string outfile, double
     outFileName.insert(outFileName.find(".root"), ".tree");
     histOutFileName = outfile;
     histOutFileName.insert(histOutFileName.find(".root"), ".hist");
+    perfOutFileName = outfile;
+    perfOutFileName.replace(perfOutFileName.find(".root"), 5, ".perf.json");
+    perfSnapshotFileName = outfile;
+    perfSnapshotFileName.replace(perfSnapshotFileName.find(".root"), 5, ".perf.snapshots.jsonl");
     nEvents = nEv;
     genWeight = WtFactor;
 
-    towerHadCorrSum.resize(4800, 0.0);
-    towerNTracksMatched.resize(4800, 0);
+    trackBuffer.reserve(1024);
 
     eventTreeArray = new TClonesArray("TTreeEvent", 1);
     jetTreeArray = new TClonesArray("TTreeJet", 20);
@@ -81,42 +89,98 @@ PicoDstAnalyzer::PicoDstAnalyzer(string infile, long nEv, string outfile, double
 }
 
 PicoDstAnalyzer::~PicoDstAnalyzer(){
-    if(outTree) delete outTree;
-    if(outFile) delete outFile;
-    if(picoDst) delete picoDst;
-    if(picoEvent) delete picoEvent;
+    //picoDst and picoEvent are owned by the picoReader
     if(outTree) delete outTree;
     if(outFile) delete outFile;
 }
 
-void PicoDstAnalyzer::init(){
-    if(fjMaker){
-        fjMaker->init();
-        cout<<"Initialized detector-level JetMaker..."<<endl;
-        fjMaker->printDescription();
-    }
-    if(fjGenMaker){
-        fjGenMaker->init();
-        cout<<"Initialized particle-level JetMaker..."<<endl;
-        fjGenMaker->printDescription();
-    }
+void PicoDstAnalyzer::setEventPlaneCalibrationBinning(int nVzBins, const double* vzBins, int nCentBins, const double* centBins){
+    epCalibrationVzBins.clear();
+    epCalibrationCentBins.clear();
+    if(nVzBins > 0 && vzBins) epCalibrationVzBins.assign(vzBins, vzBins + nVzBins + 1);
+    if(nCentBins > 0 && centBins) epCalibrationCentBins.assign(centBins, centBins + nCentBins + 1);
+}
 
+bool PicoDstAnalyzer::init(){
     if(!picoReader){
         cout<<"No picoReader found. Creating a new one..."<<endl;
         picoReader.reset(new StPicoDstReader(inFileName.c_str()));
     }
     picoReader->Init();
 
+    if( !picoReader->chain() ) {cout << "No chain has been found." << endl; return false;}
+    configureBranches();
+    if(!isWorker){
+        unsigned long events2read = picoReader->chain()->GetEntries();
+        cout << "Number of events to read: " << events2read << endl;
+        if(nEvents <= 0 || nEvents > events2read) nEvents = events2read;
+        cout << "Will read " << nEvents << " events." << endl;
+
+        genWeight = genWeight/(double)events2read;
+
+        if(useEventIndex) useEventIndex = loadEventIndex();
+    }
+
     if(!epMaker){
         cout<<"No epMaker found. Creating a new one..."<<endl;
         epMaker.reset(new EventPlaneMaker());
     }
+    epMaker->setTrackBuffer(&trackBuffer);
+
+    if(!pRes22 || !pRes24) declareEventPlaneHistos();
+    if(flowMaker){
+        flowMaker->setTrackBuffer(&trackBuffer);
+        if(!flowMaker->hasProfiles()) flowMaker->declareProfiles(nCentBins9, centBins9);
+    }
+    resolveHistograms();
+    trackSelector.configure(ptMin, ptMax, absEtaMax, nHitsFitMin, nHitsRatioMin, trkDCAMax);
+    if(!isWorker) cout<<"Track selection kernel: "<<TrackSelector::getKernelName()<<endl;
+    if(!isWorker && useTowers) cout<<"Hadronic correction: "<<HadronicCorrection::getSchemeName(hadCorr.getScheme())<<((hadCorr.getScheme() == HadronicCorrection::kFraction) ? " " + to_string(hadCorr.getFraction()) : "")<<endl;
+
+    if(!isWorker && (epCalibrationEntries > 0 || !epRecenteringFileName.empty())){
+        //Shared by the worker clones of epMaker, read-only once calibrated
+        epCalibrator = make_shared<EventPlaneCalibrator>(epMaker->getNHarmonics());
+        if(epCalibrationVzBins.empty()){
+            for(int i = 0; i <= 10; i++) epCalibrationVzBins.push_back(-absZVtxMax + i*0.2*absZVtxMax);
+        }
+        if(epCalibrationCentBins.empty()) epCalibrationCentBins.assign(centBins9, centBins9 + nCentBins9 + 1);
+        epCalibrator->setBinning(epCalibrationVzBins.size() - 1, epCalibrationVzBins.data(), epCalibrationCentBins.size() - 1, epCalibrationCentBins.data());
+        if(!epRecenteringFileName.empty()) epCalibrator->loadRawProfiles(epRecenteringFileName, epMaker->getN());
+        epMaker->setCalibrator(epCalibrator);
+    }
+
+    if(!refMultCorr){
+        refMultCorr.reset(CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi()->clone());
+        cout<<"Set up grefmultCorr..."<<endl;
+        refMultCorr->print();
+    }
 
-    declareEventPlaneHistos();
+    //Loaded before makeWorkers(), the workers share the tables
+    if(!isWorker && (!towerStatusFileName.empty() || !towerGainFileName.empty())){
+        if(!towerStatus.load(towerStatusFileName, towerGainFileName)){
+            cout<<"Could not load the tower status files, stopping."<<endl;
+            return false;
+        }
+    }
 
-    refMultCorr.reset(CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi());
-    cout<<"Set up grefmultCorr..."<<endl;
-    refMultCorr->print();
+    //In multi-threaded mode only the workers write snapshots
+    if(nThreads == 1 || isWorker) perfMon.setSnapshotInterval(perfSnapshotInterval, perfSnapshotFileName);
+
+    //In multi-threaded mode the workers own the jet finding and the outputs
+    if(nThreads > 1 && !isWorker){
+        return makeWorkers();
+    }
+
+    if(fjMaker){
+        fjMaker->init();
+        cout<<"Initialized detector-level JetMaker..."<<endl;
+        fjMaker->printDescription();
+    }
+    if(fjGenMaker){
+        fjGenMaker->init();
+        cout<<"Initialized particle-level JetMaker..."<<endl;
+        fjGenMaker->printDescription();
+    }
 
     bemcLoc.reset(new BEMCLocator());
 
@@ -127,14 +191,123 @@ void PicoDstAnalyzer::init(){
     outTree->Branch("Event", &eventTreeArray);
     outTree->Branch("Jets", &jetTreeArray);
     outTree->Branch("GenJets", &genJetTreeArray);
+    return true;
+}
+
+bool PicoDstAnalyzer::makeWorkers(){
+    ROOT::EnableThreadSafety();
+
+    long nPerWorker = (nEvents + nThreads - 1)/nThreads;
+    cout<<"Splitting "<<nEvents<<" events over "<<nThreads<<" worker threads..."<<endl;
+    for(unsigned int iw = 0; iw < nThreads; iw++){
+        long first = iw*nPerWorker;
+        long last = min(nEvents, first + nPerWorker);
+        if(first >= last) break;
+
+        //genWeight is already normalized to the number of events in the chain
+        unique_ptr<PicoDstAnalyzer> worker(new PicoDstAnalyzer(inFileName, last, outFileName, genWeight));
+        worker->isWorker = true;
+        worker->firstEvent = first;
+        worker->outFileName.insert(worker->outFileName.find(".root"), ".worker" + to_string(iw));
+        worker->histOutFileName = "";
+
+        worker->absZVtxMax = absZVtxMax;
+        worker->ptMin = ptMin;
+        worker->ptMax = ptMax;
+        worker->absEtaMax = absEtaMax;
+        worker->nHitsFitMin = nHitsFitMin;
+        worker->nHitsRatioMin = nHitsRatioMin;
+        worker->trkDCAMax = trkDCAMax;
+        worker->useTowers = useTowers;
+        worker->hadCorr.setScheme(hadCorr.getScheme());
+        worker->hadCorr.setFraction(hadCorr.getFraction());
+        //shares the loaded tables
+        worker->towerStatus = towerStatus;
+        worker->earlyRejection = earlyRejection;
+        worker->rejectBadRuns = rejectBadRuns;
+        worker->perfSnapshotInterval = perfSnapshotInterval;
+        worker->perfSnapshotFileName = perfSnapshotFileName;
+        worker->perfSnapshotFileName.insert(worker->perfSnapshotFileName.find(".jsonl"), ".worker" + to_string(iw));
+        if(useEventIndex){
+            //Workers get their slice of the pre-selected entries
+            worker->useEventIndex = true;
+            worker->indexedEvents.assign(indexedEvents.begin() + first, indexedEvents.begin() + last);
+            worker->firstEvent = 0;
+            worker->nEvents = last - first;
+        }
 
-    if( !picoReader->chain() ) {cout << "No chain has been found." << endl; return;}
-    unsigned long events2read = picoReader->chain()->GetEntries();
-    cout << "Number of events to read: " << events2read << endl;
-    if(nEvents <= 0 || nEvents > events2read) nEvents = events2read;
-    cout << "Will read " << nEvents << " events." << endl;
+        //JetMakers are copied before init() so every worker owns its own clustering
+        if(fjMaker) worker->fjMaker.reset(new JetMaker(*fjMaker));
+        if(fjGenMaker) worker->fjGenMaker.reset(new JetMaker(*fjGenMaker));
+        worker->epMaker.reset(epMaker->clone());
+        if(flowMaker) worker->flowMaker.reset(flowMaker->clone());
 
-    genWeight = genWeight/(double)events2read;
+        for(auto& hist : hist1D){
+            TH1D* h = static_cast<TH1D*>(hist.second->Clone());
+            h->SetDirectory(nullptr);
+            worker->hist1D[hist.first] = h;
+        }
+        for(auto& hist : hist2D){
+            TH2D* h = static_cast<TH2D*>(hist.second->Clone());
+            h->SetDirectory(nullptr);
+            worker->hist2D[hist.first] = h;
+        }
+        worker->pRes22 = static_cast<TProfile*>(pRes22->Clone());
+        worker->pRes22->SetDirectory(nullptr);
+        worker->pRes24 = static_cast<TProfile*>(pRes24->Clone());
+        worker->pRes24->SetDirectory(nullptr);
+        worker->pResHarmonics.clear();
+        for(auto& p : pResHarmonics){
+            TProfile* prof = static_cast<TProfile*>(p->Clone());
+            prof->SetDirectory(nullptr);
+            worker->pResHarmonics.push_back(prof);
+        }
+
+        //StRefMultCorr keeps per-event state, so every worker gets a clone sharing the parsed tables;
+        //the smearing is keyed by (runId, eventId), so results do not depend on nThreads
+        worker->refMultCorr.reset(refMultCorr->clone());
+
+        if(!worker->init()){
+            cout<<"Worker "<<iw<<" could not be initialized, stopping."<<endl;
+            workers.clear();
+            return false;
+        }
+        workers.push_back(std::move(worker));
+    }
+    return true;
+}
+
+void PicoDstAnalyzer::mergeWorkers(){
+    TFileMerger treeMerger(kFALSE);
+    treeMerger.OutputFile(outFileName.c_str(), "RECREATE");
+    for(auto& worker : workers){
+        worker->outFile->Write();
+        worker->outFile->Close();
+        worker->outTree = nullptr;
+        treeMerger.AddFile(worker->outFileName.c_str());
+
+        for(auto& hist : hist1D){
+            hist.second->Add(worker->hist1D[hist.first]);
+        }
+        for(auto& hist : hist2D){
+            hist.second->Add(worker->hist2D[hist.first]);
+        }
+        nEventsRead += worker->nEventsRead;
+        nEventHeadersRead += worker->nEventHeadersRead;
+        nEventsRejectedEarly += worker->nEventsRejectedEarly;
+        pRes22->Add(worker->pRes22);
+        pRes24->Add(worker->pRes24);
+        for(size_t n = 0; n < pResHarmonics.size(); n++){
+            pResHarmonics[n]->Add(worker->pResHarmonics[n]);
+        }
+        epMaker->merge(*worker->epMaker);
+        if(flowMaker) flowMaker->merge(*worker->flowMaker);
+        perfMon.merge(worker->perfMon);
+    }
+    treeMerger.Merge();
+    for(auto& worker : workers){
+        gSystem->Unlink(worker->outFileName.c_str());
+    }
 }
 
 void PicoDstAnalyzer::clear(){
@@ -142,16 +315,71 @@ void PicoDstAnalyzer::clear(){
     if(fjMaker)fjMaker->clear();
     if(fjGenMaker)fjGenMaker->clear();
     epMaker->clear();
+    trackBuffer.clear();
     eventTreeArray->Clear();
     jetTreeArray->Clear();
     genJetTreeArray->Clear();
-    towerHadCorrSum.assign(towerHadCorrSum.size(), 0.0);
-    towerNTracksMatched.assign(towerNTracksMatched.size(), 0);
+    hadCorr.clear();
+}
+
+void PicoDstAnalyzer::configureBranches(){
+    //Only deserialize the branches the configured analysis stages touch
+    vector<string> branches = {"Event", "Track"};
+    if(useTowers) branches.push_back("BTowHit");
+    useMcTracks = (fjGenMaker != nullptr);
+    for(auto& hist : hist1D){
+        if(hist.first.find("hGenTrack") == 0) useMcTracks = true;
+    }
+    if(useMcTracks) branches.push_back("McTrack");
+
+    picoReader->SetStatus("*", 0);
+    for(auto& branch : branches){
+        picoReader->SetStatus(branch.c_str(), 1);
+    }
+
+    bytesPerEventAll = 0;
+    bytesPerEventEnabled = 0;
+    bytesPerEventHeader = 0;
+    if(!isWorker) cout<<"PicoDst branches (uncompressed bytes/event):"<<endl;
+    TObjArray* branchList = picoReader->chain()->GetListOfBranches();
+    for(int ib = 0; ib < branchList->GetEntriesFast(); ib++){
+        TBranch* branch = static_cast<TBranch*>(branchList->At(ib));
+        double nEntries = branch->GetEntries();
+        double bytes = (nEntries > 0) ? branch->GetTotBytes("*")/nEntries : 0;
+        bool enabled = find(branches.begin(), branches.end(), string(branch->GetName())) != branches.end();
+        bytesPerEventAll += bytes;
+        if(enabled) bytesPerEventEnabled += bytes;
+        if(string(branch->GetName()) == "Event") bytesPerEventHeader = bytes;
+        if(!isWorker) cout<<Form("  %-16s %-3s %12.1f", branch->GetName(), enabled ? "ON" : "off", bytes)<<endl;
+    }
+    if(!isWorker && bytesPerEventAll > 0){
+        cout<<Form("Reading %.1f of %.1f bytes/event (%.1f%%)", bytesPerEventEnabled, bytesPerEventAll, 100.0*bytesPerEventEnabled/bytesPerEventAll)<<endl;
+    }
+}
+
+void PicoDstAnalyzer::printIOReport(){
+    if(nEventsRead < 1) return;
+    cout<<"Read "<<nEventsRead<<" events"<<endl;
+    cout<<Form("  compressed bytes read from disk/event: %.1f", (TFile::GetFileBytesRead() - epCalibrationBytesRead)/(double)nEventsRead)<<endl;
+    cout<<Form("  uncompressed bytes deserialized/event: %.1f (all branches: %.1f)", bytesPerEventEnabled, bytesPerEventAll)<<endl;
+    if(!earlyRejection || nEventHeadersRead < 1) return;
+    //Headers of rejected events were read, their tracks/towers/MC tracks were not
+    double bytesRead = nEventHeadersRead*bytesPerEventHeader + nEventsRead*(bytesPerEventEnabled - bytesPerEventHeader);
+    double bytesSkipped = nEventsRejectedEarly*(bytesPerEventEnabled - bytesPerEventHeader);
+    cout<<Form("  early rejection: %ld of %ld events rejected on the event header (%.1f%%)", nEventsRejectedEarly, nEventHeadersRead, 100.0*nEventsRejectedEarly/nEventHeadersRead)<<endl;
+    if(bytesRead + bytesSkipped > 0){
+        cout<<Form("  early rejection: %.1f%% of uncompressed bytes skipped", 100.0*bytesSkipped/(bytesRead + bytesSkipped))<<endl;
+    }
 }
 
 void PicoDstAnalyzer::finish(){
-    outFile->Write();
-    outFile->Close();
+    if(!workers.empty()){
+        mergeWorkers();
+    }else{
+        outFile->Write();
+        outFile->Close();
+        outTree = nullptr;
+    }
 
     histOutFile = new TFile(histOutFileName.c_str(), "RECREATE");
     histOutFile->cd();
@@ -164,21 +392,97 @@ void PicoDstAnalyzer::finish(){
 
     pRes22->Write();
     pRes24->Write();
+    for(auto& p : pResHarmonics){
+        p->Write();
+    }
 
     histOutFile->Write();
     histOutFile->Close();
 
     epMaker->finish();
+    if(flowMaker) flowMaker->finish();
+
+    printIOReport();
+    perfMon.print();
+    perfMon.writeJSON(perfOutFileName);
 }
 
 void PicoDstAnalyzer::eventLoop(){
-    for(unsigned int i = 0; i < nEvents; i++){
+    if(epCalibrator && epCalibrationEntries > 0) calibrateEventPlane();
+    perfMon.start();
+    if(workers.empty()){
+        processEvents(firstEvent, nEvents);
+        perfMon.stop();
+        return;
+    }
+
+    vector<thread> threads;
+    for(auto& worker : workers){
+        PicoDstAnalyzer* w = worker.get();
+        threads.emplace_back([w](){w->eventLoop();});
+    }
+    for(auto& t : threads) t.join();
+    perfMon.stop();
+}
+
+void PicoDstAnalyzer::calibrateEventPlane(){
+    //First pass over a subsample only records raw Q-vectors, no histogram or tree is filled
+    PicoDstAnalyzer* ana = workers.empty() ? this : workers[0].get();
+    long last = min(ana->nEvents, ana->firstEvent + epCalibrationEntries);
+    cout<<"Calibrating event plane on events "<<ana->firstEvent<<" - "<<last<<"..."<<endl;
+    //The subsample is read again by the main pass, so it is counted on its own monitor
+    //and left out of the event and I/O counters
+    PerformanceMonitor calibrationMon;
+    long nRead = ana->nEventsRead, nHeadersRead = ana->nEventHeadersRead, nRejectedEarly = ana->nEventsRejectedEarly;
+    Long64_t bytesRead = TFile::GetFileBytesRead();
+    swap(ana->perfMon, calibrationMon);
+    ana->perfMon.start();
+
+    epCalibrator->beginPass();
+    ana->epCalibrationPass = true;
+    ana->processEvents(ana->firstEvent, last);
+    ana->epCalibrationPass = false;
+    epCalibrator->endPass();
+
+    ana->perfMon.stop();
+    swap(ana->perfMon, calibrationMon);
+    ana->nEventsRead = nRead;
+    ana->nEventHeadersRead = nHeadersRead;
+    ana->nEventsRejectedEarly = nRejectedEarly;
+    epCalibrationBytesRead = TFile::GetFileBytesRead() - bytesRead;
+    cout<<"Event plane calibration pass:"<<endl;
+    calibrationMon.print();
+}
+
+void PicoDstAnalyzer::processEvents(long first, long last){
+    for(long i = first; i < last; i++){
         if(i%1000 == 0) cout << "Event " << i << endl;
-        bool readEvent = picoReader->readPicoEvent(i);
+        perfMon.countEvent();
+        long ientry = i;
+        if(useEventIndex){
+            ientry = indexedEvents[i].entry;
+        }else if(earlyRejection){
+            //Decide on the event header alone before paying for tracks and towers
+            if( !readEventHeader(ientry) ) {
+                cout << "Something went wrong! PicoEvent not found..." << endl;
+                break;
+            }
+            if(!selectEvent()){
+                nEventsRejectedEarly++;
+                continue;
+            }
+        }
+
+        bool readEvent = false;
+        {
+            PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kRead);
+            readEvent = picoReader->readPicoEvent(ientry);
+        }
         if( !readEvent ) {
             cout << "Something went wrong! Nothing to analyze..." << endl;
             break;
         }
+        nEventsRead++;
         clear();
 
         picoDst = picoReader->picoDst();
@@ -187,31 +491,18 @@ void PicoDstAnalyzer::eventLoop(){
             cout << "Something went wrong! PicoEvent not found..." << endl;
             break;
         }
-        
-        pVtx = picoEvent->primaryVertex();
-        if(fabs(pVtx.z()) > absZVtxMax) continue;
-        pVtx_Z = pVtx.z();
-        //cout<<"Z vertex: "<<pVtx_Z<<" bin: "<<zVtxBin<<endl;  
-
-        refMultCorr->init(picoEvent->runId());
-        refMultCorr->initEvent(picoEvent->grefMult(), pVtx.z(), picoEvent->ZDCx());
-        centbin16 = refMultCorr->getCentralityBin16();
-        centbin9 = refMultCorr->getCentralityBin9();
-
-        if(centbin16 < 0 || centbin9 < 0)continue;
-
-
-        ref16 = 15-centbin16; 
-        ref9 = 8-centbin9;
 
-        centrality = 5.0*ref16 + 2.5;
-
-        double refWeight = refMultCorr->getWeight();
-
-        weight = genWeight*refWeight;
+        if(useEventIndex){
+            if(!selectIndexedEvent(indexedEvents[i])){
+                cout << "Event index does not match entry " << ientry << " of the input chain, stopping." << endl;
+                break;
+            }
+        }
+        else if(!earlyRejection && !selectEvent()) continue;
 
-        hist1D["hCentrality"]->Fill(centrality, weight);
-        hist1D["hRefMult"]->Fill(refMultCorr->getRefMultCorr(picoEvent->grefMult(), pVtx.z(), picoEvent->ZDCx(), 2), weight);
+        perfMon.countAcceptedEvent();
+        if(hCentrality && !epCalibrationPass) hCentrality->Fill(centrality, weight);
+        if(hRefMult && !epCalibrationPass) hRefMult->Fill(refMultCorrValue, weight);
 
         treeEvent = static_cast<TTreeEvent*>(eventTreeArray->ConstructedAt(0));
         treeEvent->runId = picoEvent->runId();
@@ -219,83 +510,356 @@ void PicoDstAnalyzer::eventLoop(){
         treeEvent->centrality = centrality;
         treeEvent->primaryVertexZ = pVtx_Z;
         treeEvent->genWeight = genWeight;
-        treeEvent->refMultWeight = refWeight;
+        treeEvent->refMultWeight = refMultWeight;
 
         trackLoop();
-        towerLoop();
+        if(flowMaker && !epCalibrationPass){
+            PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kFlowCumulants);
+            flowMaker->calculate(centrality, weight);
+        }
+        if(useTowers)towerLoop();
         if(fjMaker)jetLoop();
-        genTrackLoop();
+        if(useMcTracks)genTrackLoop();
         if(fjGenMaker)genJetLoop();
         //cout<<"Going to make event plane..."<<endl;
         if((treeEvent->nDetectorJets < 1) && (treeEvent->nGenJets < 1))continue;
         makeEventPlane();
+        if(epCalibrationPass) continue;
 
+        PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kTreeFill);
         outTree->Fill();
     }
 }
 
+bool PicoDstAnalyzer::readEventHeader(long ientry){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kRead);
+    TChain* chain = picoReader->chain();
+    Long64_t localEntry = chain->LoadTree(ientry);
+    if(localEntry < 0) return false;
+    if(!eventBranch || chain->GetTreeNumber() != eventBranchTreeNumber){
+        eventBranch = chain->GetTree()->GetBranch("Event");
+        eventBranchTreeNumber = chain->GetTreeNumber();
+    }
+    if(!eventBranch || eventBranch->GetEntry(localEntry) <= 0) return false;
+    nEventHeadersRead++;
+
+    picoDst = picoReader->picoDst();
+    picoEvent = picoDst->event();
+    return (picoEvent != nullptr);
+}
+
+bool PicoDstAnalyzer::selectEvent(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kEventSelection);
+    pVtx = picoEvent->primaryVertex();
+    if(fabs(pVtx.z()) > absZVtxMax) return false;
+    pVtx_Z = pVtx.z();
+    //cout<<"Z vertex: "<<pVtx_Z<<" bin: "<<zVtxBin<<endl;  
+
+    if(rejectBadRuns && refMultCorr->isBadRun(picoEvent->runId())) return false;
+    refMultCorr->init(picoEvent->runId());
+    refMultCorr->initEvent(picoEvent->grefMult(), pVtx.z(), picoEvent->ZDCx(), picoEvent->runId(), picoEvent->eventId());
+    centbin16 = refMultCorr->getCentralityBin16();
+    centbin9 = refMultCorr->getCentralityBin9();
+
+    if(centbin16 < 0 || centbin9 < 0) return false;
+
+    ref16 = 15-centbin16; 
+    ref9 = 8-centbin9;
+
+    centrality = 5.0*ref16 + 2.5;
+
+    refMultWeight = refMultCorr->getWeight();
+    //the corrected multiplicity the centrality bins were taken from
+    refMultCorrValue = refMultCorr->getRefMultCorr();
+
+    weight = genWeight*refMultWeight;
+    return true;
+}
+
+bool PicoDstAnalyzer::selectIndexedEvent(const IndexedEvent& ev){
+    if(picoEvent->runId() != ev.runId || picoEvent->eventId() != ev.eventId) return false;
+    pVtx = picoEvent->primaryVertex();
+    pVtx_Z = pVtx.z();
+
+    centbin16 = ev.centbin16;
+    centbin9 = ev.centbin9;
+    ref16 = 15-centbin16; 
+    ref9 = 8-centbin9;
+    centrality = 5.0*ref16 + 2.5;
+
+    refMultWeight = ev.refMultWeight;
+    refMultCorrValue = ev.refMultCorr;
+    weight = genWeight*refMultWeight;
+    return true;
+}
+
+string PicoDstAnalyzer::getEventIndexFileName(){
+    if(eventIndexFileName != "") return eventIndexFileName;
+    string name = inFileName;
+    size_t slash = name.rfind('/');
+    size_t dot = name.rfind('.');
+    if(dot != string::npos && (slash == string::npos || dot > slash)) name = name.substr(0, dot);
+    return name + ".eventIndex.root";
+}
+
+void PicoDstAnalyzer::getChainFiles(TChain* chain, vector<string>& names, vector<Long64_t>& entries){
+    names.clear();
+    entries.clear();
+    chain->GetEntries(); //loads the tree offsets of all files
+    TObjArray* files = chain->GetListOfFiles();
+    const Long64_t* offset = chain->GetTreeOffset();
+    for(int i = 0; i < files->GetEntriesFast(); i++){
+        names.push_back(gSystem->BaseName(files->At(i)->GetTitle()));
+        entries.push_back(offset[i+1] - offset[i]);
+    }
+}
+
+void PicoDstAnalyzer::buildEventIndex(){
+    StPicoDstReader* reader = getPicoReader();
+    reader->Init();
+    if( !reader->chain() ) {cout << "No chain has been found." << endl; return;}
+    reader->SetStatus("*", 0);
+    reader->SetStatus("Event", 1);
+
+    if(!refMultCorr){
+        refMultCorr.reset(CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi()->clone());
+    }
+
+    string indexName = getEventIndexFileName();
+    TFile indexFile(indexName.c_str(), "RECREATE");
+    TTree* indexTree = new TTree("EventIndex", refMultCorr->getName().Data());
+
+    Long64_t entry;
+    Int_t runId, eventId, cent16, cent9;
+    UShort_t gRefMult;
+    Float_t vz, zdcx;
+    Double_t refMult, refWeight;
+    indexTree->Branch("entry", &entry, "entry/L");
+    indexTree->Branch("runId", &runId, "runId/I");
+    indexTree->Branch("eventId", &eventId, "eventId/I");
+    indexTree->Branch("vz", &vz, "vz/F");
+    indexTree->Branch("grefMult", &gRefMult, "grefMult/s");
+    indexTree->Branch("ZDCx", &zdcx, "ZDCx/F");
+    indexTree->Branch("centbin16", &cent16, "centbin16/I");
+    indexTree->Branch("centbin9", &cent9, "centbin9/I");
+    indexTree->Branch("refMultCorr", &refMult, "refMultCorr/D");
+    indexTree->Branch("refMultWeight", &refWeight, "refMultWeight/D");
+
+    //Events are classified in blocks of one run with the StRefMultCorr batch API
+    const size_t blockSize = 4096;
+    vector<Long64_t> blockEntry;
+    vector<Int_t> blockEventId, blockCent16(blockSize), blockCent9(blockSize);
+    vector<UShort_t> blockGRefMult;
+    vector<Double_t> blockVz, blockZdcx, blockRefMult(blockSize), blockWeight(blockSize);
+    Int_t blockRunId = -1;
+    auto flushBlock = [&](){
+        if(blockEntry.empty()) return;
+        refMultCorr->getCentrality(blockRunId, blockEntry.size(), blockGRefMult.data(), blockVz.data(), blockZdcx.data(),
+                                   blockRefMult.data(), blockCent16.data(), blockCent9.data(), blockWeight.data(),
+                                   blockEventId.data());
+        for(size_t i = 0; i < blockEntry.size(); i++){
+            entry = blockEntry[i];
+            runId = blockRunId;
+            eventId = blockEventId[i];
+            vz = blockVz[i];
+            gRefMult = blockGRefMult[i];
+            zdcx = blockZdcx[i];
+            cent16 = blockCent16[i];
+            cent9 = blockCent9[i];
+            refMult = blockRefMult[i];
+            refWeight = blockWeight[i];
+            indexTree->Fill();
+        }
+        blockEntry.clear();
+        blockEventId.clear();
+        blockGRefMult.clear();
+        blockVz.clear();
+        blockZdcx.clear();
+    };
+
+    Long64_t nEntries = reader->chain()->GetEntries();
+    cout<<"Building event index "<<indexName<<" for "<<nEntries<<" events..."<<endl;
+    for(Long64_t ientry = 0; ientry < nEntries; ientry++){
+        if(ientry%100000 == 0) cout << "Event " << ientry << endl;
+        if(!reader->readPicoEvent(ientry)) break;
+        StPicoEvent* event = reader->picoDst()->event();
+        if(!event) break;
+
+        if(event->runId() != blockRunId || blockEntry.size() == blockSize) flushBlock();
+        blockRunId = event->runId();
+        blockEntry.push_back(ientry);
+        blockEventId.push_back(event->eventId());
+        //same float precision as the index branches
+        blockVz.push_back((Float_t)event->primaryVertex().z());
+        blockGRefMult.push_back(event->grefMult());
+        blockZdcx.push_back((Float_t)event->ZDCx());
+    }
+    flushBlock();
+
+    //Input files the entry numbers refer to, checked on load
+    TTree* filesTree = new TTree("EventIndexFiles", "EventIndexFiles");
+    string fileName;
+    Long64_t fileEntries;
+    filesTree->Branch("fileName", &fileName);
+    filesTree->Branch("entries", &fileEntries, "entries/L");
+    vector<string> names;
+    vector<Long64_t> entries;
+    getChainFiles(reader->chain(), names, entries);
+    for(size_t i = 0; i < names.size(); i++){
+        fileName = names[i];
+        fileEntries = entries[i];
+        filesTree->Fill();
+    }
+
+    indexFile.Write();
+    indexFile.Close();
+    cout<<"Wrote event index "<<indexName<<endl;
+}
+
+bool PicoDstAnalyzer::loadEventIndex(){
+    string indexName = getEventIndexFileName();
+    TFile indexFile(indexName.c_str(), "READ");
+    TTree* indexTree = nullptr;
+    if(!indexFile.IsZombie()) indexFile.GetObject("EventIndex", indexTree);
+    if(!indexTree){
+        cout<<"Event index "<<indexName<<" not found. Reading all events..."<<endl;
+        return false;
+    }
+    //Same centrality definition, same files in the same order with the same number of entries
+    bool match = (indexTree->GetEntries() == picoReader->chain()->GetEntries());
+    TString flavor = refMultCorr ? refMultCorr->getName() : CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi()->getName();
+    if(flavor != indexTree->GetTitle()){
+        cout<<"Event index "<<indexName<<" was built for "<<indexTree->GetTitle()<<", not "<<flavor<<endl;
+        match = false;
+    }
+    TTree* filesTree = nullptr;
+    indexFile.GetObject("EventIndexFiles", filesTree);
+    vector<string> names;
+    vector<Long64_t> entries;
+    getChainFiles(picoReader->chain(), names, entries);
+    if(!filesTree || filesTree->GetEntries() != (Long64_t)names.size()){
+        match = false;
+    }else{
+        string* fileName = nullptr;
+        Long64_t fileEntries;
+        filesTree->SetBranchAddress("fileName", &fileName);
+        filesTree->SetBranchAddress("entries", &fileEntries);
+        for(size_t i = 0; i < names.size() && match; i++){
+            filesTree->GetEntry(i);
+            if(*fileName != names[i] || fileEntries != entries[i]){
+                cout<<"Event index "<<indexName<<": file "<<i<<" is "<<names[i]<<" ("<<entries[i]<<" entries), index has "<<*fileName<<" ("<<fileEntries<<" entries)"<<endl;
+                match = false;
+            }
+        }
+        delete fileName;
+    }
+    if(!match){
+        cout<<"Event index "<<indexName<<" does not match the input chain. Reading all events..."<<endl;
+        return false;
+    }
+
+    if(rejectBadRuns && !refMultCorr){
+        refMultCorr.reset(CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi()->clone());
+    }
+
+    Long64_t entry;
+    Int_t runId, eventId, cent16, cent9;
+    Float_t vz;
+    Double_t refMult, refWeight;
+    indexTree->SetBranchStatus("*", 0);
+    indexTree->SetBranchStatus("entry", 1);
+    indexTree->SetBranchStatus("runId", 1);
+    indexTree->SetBranchStatus("eventId", 1);
+    indexTree->SetBranchStatus("vz", 1);
+    indexTree->SetBranchStatus("centbin16", 1);
+    indexTree->SetBranchStatus("centbin9", 1);
+    indexTree->SetBranchStatus("refMultCorr", 1);
+    indexTree->SetBranchStatus("refMultWeight", 1);
+    indexTree->SetBranchAddress("entry", &entry);
+    indexTree->SetBranchAddress("runId", &runId);
+    indexTree->SetBranchAddress("eventId", &eventId);
+    indexTree->SetBranchAddress("vz", &vz);
+    indexTree->SetBranchAddress("centbin16", &cent16);
+    indexTree->SetBranchAddress("centbin9", &cent9);
+    indexTree->SetBranchAddress("refMultCorr", &refMult);
+    indexTree->SetBranchAddress("refMultWeight", &refWeight);
+
+    indexedEvents.clear();
+    Long64_t nIndexed = min<Long64_t>(nEvents, indexTree->GetEntries());
+    for(Long64_t i = 0; i < nIndexed; i++){
+        indexTree->GetEntry(i);
+        if(fabs(vz) > absZVtxMax) continue;
+        if(cent16 < 0 || cent9 < 0) continue;
+        if(rejectBadRuns && refMultCorr->isBadRun(runId)) continue;
+        indexedEvents.push_back({entry, runId, eventId, cent16, cent9, refMult, refWeight});
+    }
+    cout<<"Event index "<<indexName<<": "<<indexedEvents.size()<<" of "<<nIndexed<<" events pass the event selection"<<endl;
+    nEvents = indexedEvents.size();
+    return true;
+}
+
 void PicoDstAnalyzer::trackLoop(){
-    for(unsigned int itrk = 0; itrk < picoDst->numberOfTracks(); itrk++){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kTrackLoop);
+    size_t nTracks = trackSelector.select(picoDst, pVtx);
+    for(size_t itrk = 0; itrk < nTracks; itrk++){
+        if(!trackSelector.isSelected(itrk)) continue;
         StPicoTrack* trk = picoDst->track(itrk);
-        if(!trk) continue;
-        if(!(trk->isPrimary())) continue;
-        if(trk->nHitsFit() < nHitsFitMin) continue;
-        if((trk->nHitsFit()/(double)trk->nHitsMax()) < nHitsRatioMin) continue;
-        if(trk->gDCA(pVtx).Mag() > trkDCAMax) continue;
-
-        TVector3 trkMom = trk->pMom();
-        if(trkMom.Pt() < ptMin) continue;
-        if(trkMom.Pt() > ptMax) continue;
-        if(fabs(trkMom.Eta()) > absEtaMax) continue;
-
-        double E = sqrt(trkMom.Mag2() + pi0mass*pi0mass);
-
-        int towerMatched = trk->bemcTowerIndex();
-        if(towerMatched >= 0){
-            towerNTracksMatched[towerMatched]++;   
-            towerHadCorrSum[towerMatched] += E;
-        }
+        trackBuffer.add(itrk, trackSelector.getPx(itrk), trackSelector.getPy(itrk), trackSelector.getPz(itrk), pi0mass, trk->charge(), trk->bemcTowerIndex(), TrackBuffer::kPrimary);
+    }
 
-        epMaker->addTrack(*trk);
+    //Every consumer below reads the decoded columns instead of the StPicoTrack
+    for(size_t i = 0; i < trackBuffer.size(); i++){
+        if(trackBuffer.hasBit(i, TrackBuffer::kTowerMatched)) hadCorr.addTrack(trackBuffer.towerIndex[i]+1, trackBuffer.e[i]);
 
-        fillTrackHistos(trk);
+        fillTrackHistos(i);
 
         if(!fjMaker)continue;
-        fjMaker->inputForClustering(itrk, trkMom.Px(), trkMom.Py(), trkMom.Pz(), E);
+        fjMaker->inputForClustering(trackBuffer.index[i], trackBuffer.px[i], trackBuffer.py[i], trackBuffer.pz[i], trackBuffer.e[i]);
     }
 }
 
 void PicoDstAnalyzer::towerLoop(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kTowerLoop);
+    towerKinematics.clear();
+    towerHitEnergy.clear();
+    towerStatus.setRun(picoEvent->runId());
     for(unsigned int itow = 0; itow < picoDst->numberOfBTowHits(); itow++){
         StPicoBTowHit* tow = picoDst->btowHit(itow);
         if(!tow) continue;
-        if(tow->energy() < ptMin) continue;
+        if(!towerStatus.isGood(itow+1)) continue;
+        double rawE = tow->energy()*towerStatus.getGain(itow+1);
+        if(rawE < ptMin) continue;
 
-        double E = tow->energy();
-        if(towerNTracksMatched[itow] > 0){
-            E -= towerHadCorrSum[itow]/towerNTracksMatched[itow];
-        }
+        double E = hadCorr.correct(itow+1, rawE);
         if(E < ptMin) continue;
 
-        TVector3 towPos = bemcLoc->getTowerPosition(itow+1, pVtx);
-        double towEta = towPos.Eta();
+        towerKinematics.softId.push_back(itow+1);
+        towerHitEnergy.push_back(E);
+    }
+
+    //Vertex-corrected eta, phi and Et scale of all surviving towers in one pass
+    bemcLoc->getTowerKinematics(pVtx, towerKinematics);
+
+    for(size_t i = 0; i < towerKinematics.size(); i++){
+        double towEta = towerKinematics.eta[i];
         if(fabs(towEta) > absEtaMax) continue;
 
-        double Et = E/cosh(towEta);
+        double E = towerHitEnergy[i];
+        double Et = E*towerKinematics.etScale[i];
         if(Et < ptMin) continue;
         if(Et > ptMax) continue;
 
         double towMom = sqrt(E*E - pi0mass*pi0mass);
-        towPos.SetMag(towMom);
 
-        fillTowerHistos(Et, towPos);
+        fillTowerHistos(Et, towEta, towerKinematics.phi[i]);
 
         if(!fjMaker)continue;
-        fjMaker->inputForClustering(-itow-2, towPos.Px(), towPos.Py(), towPos.Pz(), E);
+        fjMaker->inputForClustering(-towerKinematics.softId[i]-1, towMom*towerKinematics.ux[i], towMom*towerKinematics.uy[i], towMom*towerKinematics.uz[i], E);
     }
 }
 
 void PicoDstAnalyzer::genTrackLoop(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kGenTrackLoop);
     for(unsigned int igen = 0; igen < picoDst->numberOfMcTracks(); igen++){
         StPicoMcTrack* genTrk = picoDst->mcTrack(igen);
         if(!genTrk) continue;
@@ -318,53 +882,58 @@ void PicoDstAnalyzer::genTrackLoop(){
 }
 
 void PicoDstAnalyzer::jetLoop(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kJetLoop);
     vector<JetVector> Jets = fjMaker->getFullJets();
     unsigned int NJets = Jets.size();
     if(NJets < 1) return;
 
     treeEvent->nDetectorJets = NJets;
 
-    epMaker->setLeadingJet(Jets[0]);
-    //epMaker->setSubLeadingJet(Jets[1]);
+    epMaker->setJets(Jets);
 
-    hist1D["hNJets"]->Fill(NJets, weight);
+    if(hNJets && !epCalibrationPass) hNJets->Fill(NJets, weight);
+    double obs[kNJetObservables];
     for(JetVector& jet : Jets){
-        fillJetHistos(jet);
+        computeJetObservables(jet, obs);
+        fillJetHistos(obs);
         TTreeJet* treeJet = static_cast<TTreeJet*>(jetTreeArray->ConstructedAt(jetTreeArray->GetEntriesFast()));
-        treeJet->Pt = jet.pt();
-        treeJet->Eta = jet.eta();
-        treeJet->Phi = jet.phi();
-        treeJet->NEF = jet.getNeutralPtFraction();
+        treeJet->Pt = obs[kJetPt];
+        treeJet->Eta = obs[kJetEta];
+        treeJet->Phi = obs[kJetPhi];
+        treeJet->NEF = obs[kJetNEF];
         if(jet.has_area())treeJet->Area = jet.area();
         treeJet->NNeutral = jet.nNeutralConstituents();
         treeJet->NCharged = jet.nChargedConstituents();
-        treeJet->JetPtD = (jet.nChargedConstituents() > 1) ? jet.getChargedAngularity(2, 0, true) : -1;
-        treeJet->JetGirth = (jet.nChargedConstituents() > 1) ? jet.getChargedAngularity(1, 1, false) : -1;
-        treeJet->JetLeSub = (jet.nChargedConstituents() > 1) ? jet.getChargedConstituent(0).perp() - jet.getChargedConstituent(1).perp() : -1;
+        treeJet->JetPtD = obs[kJetPtD];
+        treeJet->JetGirth = obs[kJetGirth];
+        treeJet->JetLeSub = obs[kJetLeSub];
     }
 }
 
 void PicoDstAnalyzer::genJetLoop(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kGenJetLoop);
     vector<JetVector> Jets = fjGenMaker->getFullJets();
     unsigned int NJets = Jets.size();
     if(NJets < 1) return;
 
     treeEvent->nGenJets = NJets;
 
-    hist1D["hNGenJets"]->Fill(NJets, weight);
+    if(hNGenJets && !epCalibrationPass) hNGenJets->Fill(NJets, weight);
+    double obs[kNJetObservables];
     for(JetVector& jet : Jets){
-        fillGenJetHistos(jet);
+        computeJetObservables(jet, obs);
+        fillGenJetHistos(obs);
         TTreeJet* genTreeJet = static_cast<TTreeJet*>(genJetTreeArray->ConstructedAt(genJetTreeArray->GetEntriesFast()));
-        genTreeJet->Pt = jet.pt();
-        genTreeJet->Eta = jet.eta();
-        genTreeJet->Phi = jet.phi();
-        genTreeJet->NEF = jet.getNeutralPtFraction();
+        genTreeJet->Pt = obs[kJetPt];
+        genTreeJet->Eta = obs[kJetEta];
+        genTreeJet->Phi = obs[kJetPhi];
+        genTreeJet->NEF = obs[kJetNEF];
         if(jet.has_area())genTreeJet->Area = jet.area();
         genTreeJet->NNeutral = jet.nNeutralConstituents();
         genTreeJet->NCharged = jet.nChargedConstituents();
-        genTreeJet->JetPtD = (jet.nChargedConstituents() > 1) ? jet.getChargedAngularity(2, 0, true) : -1;
-        genTreeJet->JetGirth = (jet.nChargedConstituents() > 1) ? jet.getChargedAngularity(1, 1, false) : -1;
-        genTreeJet->JetLeSub = (jet.nChargedConstituents() > 1) ? jet.getChargedConstituent(0).perp() - jet.getChargedConstituent(1).perp() : -1;
+        genTreeJet->JetPtD = obs[kJetPtD];
+        genTreeJet->JetGirth = obs[kJetGirth];
+        genTreeJet->JetLeSub = obs[kJetLeSub];
     }
 }
 
@@ -373,11 +942,22 @@ void PicoDstAnalyzer::declareEventPlaneHistos(){
     pRes22->Sumw2();
     pRes24 = new TProfile("profRes24", "<cos(4(#Psi_{2, A}^{Raw} - #Psi_{2, B}^{Raw}))>", nCentBins9, centBins9);
     pRes24->Sumw2();
+    pResHarmonics.clear();
+    for(unsigned int n = 1; n <= epMaker->getNHarmonics(); n++){
+        string hname = "profResPsi" + to_string(n);
+        string htitle = "<cos(" + to_string(n) + "(#Psi_{" + to_string(n) + ", A}^{Raw} - #Psi_{" + to_string(n) + ", B}^{Raw}))>";
+        TProfile* prof = new TProfile(hname.c_str(), htitle.c_str(), nCentBins9, centBins9);
+        prof->Sumw2();
+        pResHarmonics.push_back(prof);
+    }
 }
 
 void PicoDstAnalyzer::makeEventPlane(){
+    PerformanceMonitor::ScopedTimer timer(perfMon, PerformanceMonitor::kEventPlane);
     //cout << "PicoDstAnalyzer::makeEventPlane" << endl;
+    epMaker->setRunId(picoEvent->runId());
     epMaker->calculateEventPlane(pVtx_Z, centrality);
+    if(epCalibrationPass) return;
 
     treeEvent->raw_Qx_2 = epMaker->getQx();
     treeEvent->raw_Qx_A_2 = epMaker->getQx_A();
@@ -395,8 +975,38 @@ void PicoDstAnalyzer::makeEventPlane(){
     treeEvent->subEventPlaneMult_A = epMaker->getSubEventMult_A();
     treeEvent->subEventPlaneMult_B = epMaker->getSubEventMult_B();
 
+    unsigned int nHarmonics = min(epMaker->getNHarmonics(), (unsigned int)TTreeEvent::kMaxHarmonics);
+    treeEvent->nHarmonics = nHarmonics;
+    for(unsigned int n = 1; n <= nHarmonics; n++){
+        treeEvent->raw_Qx[n-1] = epMaker->getQx(n);
+        treeEvent->raw_Qy[n-1] = epMaker->getQy(n);
+        treeEvent->raw_Qx_A[n-1] = epMaker->getQx_A(n);
+        treeEvent->raw_Qy_A[n-1] = epMaker->getQy_A(n);
+        treeEvent->raw_Qx_B[n-1] = epMaker->getQx_B(n);
+        treeEvent->raw_Qy_B[n-1] = epMaker->getQy_B(n);
+        treeEvent->raw_psi[n-1] = epMaker->getPsi(n);
+        treeEvent->raw_psi_A[n-1] = epMaker->getPsi_A(n);
+        treeEvent->raw_psi_B[n-1] = epMaker->getPsi_B(n);
+    }
+
+    treeEvent->calibrated = epMaker->isCalibrated();
+    for(unsigned int n = 1; treeEvent->calibrated && n <= nHarmonics; n++){
+        treeEvent->Qx[n-1] = epMaker->getQx_corr(n);
+        treeEvent->Qy[n-1] = epMaker->getQy_corr(n);
+        treeEvent->Qx_A[n-1] = epMaker->getQx_A_corr(n);
+        treeEvent->Qy_A[n-1] = epMaker->getQy_A_corr(n);
+        treeEvent->Qx_B[n-1] = epMaker->getQx_B_corr(n);
+        treeEvent->Qy_B[n-1] = epMaker->getQy_B_corr(n);
+        treeEvent->psi[n-1] = epMaker->getPsi_corr(n);
+        treeEvent->psi_A[n-1] = epMaker->getPsi_A_corr(n);
+        treeEvent->psi_B[n-1] = epMaker->getPsi_B_corr(n);
+    }
+
     pRes22->Fill(centrality, epMaker->getEPResolution(2));
     pRes24->Fill(centrality, epMaker->getEPResolution(4));
+    for(size_t n = 1; n <= pResHarmonics.size(); n++){
+        pResHarmonics[n-1]->Fill(centrality, epMaker->getEPResolution(n, n));
+    }
 }
 
 StPicoDstReader* PicoDstAnalyzer::getPicoReader() { 
@@ -419,6 +1029,11 @@ EventPlaneMaker* PicoDstAnalyzer::getEPMaker() {
     return epMaker.get(); 
 }
 
+FlowCumulantMaker* PicoDstAnalyzer::getFlowMaker() { 
+    if(!flowMaker)flowMaker.reset(new FlowCumulantMaker()); 
+    return flowMaker.get(); 
+}
+
 void PicoDstAnalyzer::addHist1D(string name, string title, int nBins, double xMin, double xMax){
     hist1D[name] = new TH1D(name.c_str(), title.c_str(), nBins, xMin, xMax);
     hist1D[name]->Sumw2(); 
@@ -429,60 +1044,105 @@ void PicoDstAnalyzer::addHist2D(string name, string title, int nBinsX, double xM
     hist2D[name]->Sumw2();
 }
 
-void PicoDstAnalyzer::fillHist1D(string name, double x, double wt){
-    if(hist1D.find(name) == hist1D.end()) return;
-    hist1D[name]->Fill(x, wt);
+TH1D* PicoDstAnalyzer::findHist1D(string name){
+    auto it = hist1D.find(name);
+    return (it == hist1D.end()) ? nullptr : it->second;
 }
 
-void PicoDstAnalyzer::fillHist2D(string name, double x, double y, double wt){
-    if(hist2D.find(name) == hist2D.end()) return;
-    hist2D[name]->Fill(x, y, wt);
+TH2D* PicoDstAnalyzer::findHist2D(string name){
+    auto it = hist2D.find(name);
+    return (it == hist2D.end()) ? nullptr : it->second;
 }
 
-void PicoDstAnalyzer::fillTrackHistos(StPicoTrack* trk){
-    if(!trk) return;
-    for(auto& var : trackVars){
-        fillHist1D("hTrack" + var.first, var.second(trk), weight);
+void PicoDstAnalyzer::resolveJetHistograms(string prefix, vector<JetHist1D>& hists1D, vector<JetHist2D>& hists2D){
+    //Only the booked h<prefix><var> and h2<prefix><varX>v<varY> combinations are filled
+    hists1D.clear();
+    hists2D.clear();
+    for(int i = 0; i < kNJetObservables; i++){
+        TH1D* h = findHist1D("h" + prefix + jetObservableNames[i]);
+        if(h) hists1D.push_back({i, h});
+        for(int j = 0; j < kNJetObservables; j++){
+            TH2D* h2 = findHist2D("h2" + prefix + jetObservableNames[i] + "v" + jetObservableNames[j]);
+            if(h2) hists2D.push_back({i, j, h2});
+        }
     }
 }
 
-void PicoDstAnalyzer::fillTowerHistos(double towEt, TVector3& towPos){
-    for(auto& var : towerVars){
-        fillHist1D("hTower" + var.first, var.second(towEt, towPos), weight);
+void PicoDstAnalyzer::resolveHistograms(){
+    trackHists.clear();
+    for(auto& var : trackVars){
+        TH1D* h = findHist1D("hTrack" + var.first);
+        if(h) trackHists.push_back(make_pair(var.second, h));
     }
-}
-
-void PicoDstAnalyzer::fillGenTrackHistos(StPicoMcTrack* trk){
-    if(!trk) return;
+    genTrackHists.clear();
     for(auto& var : genTrackVars){
-        fillHist1D("hGenTrack" + var.first, var.second(trk), genWeight);
+        TH1D* h = findHist1D("hGenTrack" + var.first);
+        if(h) genTrackHists.push_back(make_pair(var.second, h));
     }
-
+    towerHists.clear();
+    for(auto& var : towerVars){
+        TH1D* h = findHist1D("hTower" + var.first);
+        if(h) towerHists.push_back(make_pair(var.second, h));
+    }
+    resolveJetHistograms("Jet", jetHists1D, jetHists2D);
+    resolveJetHistograms("GenJet", genJetHists1D, genJetHists2D);
+    hCentrality = findHist1D("hCentrality");
+    hRefMult = findHist1D("hRefMult");
+    hNJets = findHist1D("hNJets");
+    hNGenJets = findHist1D("hNGenJets");
 }
 
-void PicoDstAnalyzer::fillJetHistos(JetVector& jet){
-    for(auto& var : jetVars){
-        fillHist1D("hJet" + var.first, var.second(jet), weight);
-        for(auto& var2 : jetVars){
-            fillHist2D("h2Jet" + var.first + "v" + var2.first, var.second(jet), var2.second(jet), weight);
-        }
+void PicoDstAnalyzer::fillTrackHistos(size_t itrk){
+    if(epCalibrationPass) return;
+    for(auto& h : trackHists){
+        h.second->Fill(h.first(trackBuffer, itrk), weight);
     }
 }
 
-void PicoDstAnalyzer::fillGenJetHistos(JetVector& jet){
-    for(auto& var : jetVars){
-        fillHist1D("hGenJet" + var.first, var.second(jet), genWeight);
-        for(auto& var2 : jetVars){
-            fillHist2D("h2GenJet" + var.first + "v" + var2.first, var.second(jet), var2.second(jet), genWeight);
-        }
+void PicoDstAnalyzer::fillTowerHistos(double towEt, double towEta, double towPhi){
+    if(epCalibrationPass) return;
+    for(auto& h : towerHists){
+        h.second->Fill(h.first(towEt, towEta, towPhi), weight);
     }
 }
 
+void PicoDstAnalyzer::fillGenTrackHistos(StPicoMcTrack* trk){
+    if(epCalibrationPass) return;
+    if(!trk) return;
+    for(auto& h : genTrackHists){
+        h.second->Fill(h.first(trk), genWeight);
+    }
 
+}
 
+void PicoDstAnalyzer::computeJetObservables(JetVector& jet, double* obs){
+    //Every observable is evaluated exactly once per jet
+    bool hasCharged = jet.nChargedConstituents() > 1;
+    obs[kJetPt] = jet.pt();
+    obs[kJetEta] = jet.eta();
+    obs[kJetPhi] = jet.phi();
+    obs[kJetNEF] = jet.getNeutralPtFraction();
+    obs[kJetLeSub] = hasCharged ? jet.getChargedConstituent(0).perp() - jet.getChargedConstituent(1).perp() : -1;
+    obs[kJetPtD] = hasCharged ? jet.getChargedAngularity(2, 0, true) : -1;
+    obs[kJetGirth] = hasCharged ? jet.getChargedAngularity(1, 1, false) : -1;
+}
 
+void PicoDstAnalyzer::fillJetHistos(const double* obs){
+    if(epCalibrationPass) return;
+    for(auto& h : jetHists1D){
+        h.hist->Fill(obs[h.var], weight);
+    }
+    for(auto& h : jetHists2D){
+        h.hist->Fill(obs[h.varX], obs[h.varY], weight);
+    }
+}
 
-
-
-
-
+void PicoDstAnalyzer::fillGenJetHistos(const double* obs){
+    if(epCalibrationPass) return;
+    for(auto& h : genJetHists1D){
+        h.hist->Fill(obs[h.var], genWeight);
+    }
+    for(auto& h : genJetHists2D){
+        h.hist->Fill(obs[h.varX], obs[h.varY], genWeight);
+    }
+}
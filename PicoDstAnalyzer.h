@@ -3,14 +3,22 @@
 
 #include "TVector3.h"
 
+#include "BEMCLocator.h"
+#include "BEMCTowerStatus.h"
+#include "HadronicCorrection.h"
+#include "PerformanceMonitor.h"
+#include "TrackBuffer.h"
+#include "TrackSelector.h"
+
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
-#include <functional>
 
 class TClonesArray;
 class TTree;
+class TBranch;
+class TChain;
 class TFile;
 
 class StPicoDst;
@@ -20,7 +28,6 @@ class StPicoTrack;
 class StPicoMcTrack;
 
 class StRefMultCorr;
-class BEMCLocator;
 
 class JetMaker;
 class JetBackgroundMaker;
@@ -29,6 +36,8 @@ class JetVector;
 class TTreeEvent;
 
 class EventPlaneMaker;
+class EventPlaneCalibrator;
+class FlowCumulantMaker;
 
 class TH1D;
 class TH2D;
@@ -40,8 +49,9 @@ public:
     PicoDstAnalyzer(std::string infileName, long nEv = -1, std::string outfileName = "test.root", double WtFactor = 1.0);
     virtual ~PicoDstAnalyzer();
 
-    void run(){init(); eventLoop(); finish();}
-    void init();
+    void run(){if(!init()) return; eventLoop(); finish();}
+    //false if the input chain or explicitly requested calibration files can not be read
+    bool init();
     void finish();
     void eventLoop();
 
@@ -52,6 +62,8 @@ public:
     TTreeEvent* treeEvent = nullptr;
 
     EventPlaneMaker* getEPMaker();
+    //Q-cumulant flow analysis, only run when requested through this getter
+    FlowCumulantMaker* getFlowMaker();
 
     void setAbsZVtxMax(double zVtxMax){absZVtxMax = zVtxMax;}
     void setPtMin(double pt){ptMin = pt;}
@@ -61,12 +73,57 @@ public:
     void setNHitsRatioMin(double nHitsRatio){nHitsRatioMin = nHitsRatio;}
     void setTrackDCAMax(double dca){trkDCAMax = dca;}
 
+    void setNThreads(unsigned int n){nThreads = (n > 0) ? n : 1;}
+    void setUseTowers(bool use){useTowers = use;}
+    //Bad-tower and gain tables, see BEMCTowerFiles/
+    void setTowerStatusFiles(std::string badTowerFile, std::string gainFile = ""){towerStatusFileName = badTowerFile; towerGainFileName = gainFile;}
+    //fraction is only used by HadronicCorrection::kFraction
+    void setHadronicCorrection(HadronicCorrection::Scheme scheme, double fraction = 1.0){hadCorr.setScheme(scheme); hadCorr.setFraction(fraction);}
+    void setEarlyRejection(bool early){earlyRejection = early;}
+    //Runs in the StRefMultCorr bad-run lists
+    void setRejectBadRuns(bool reject){rejectBadRuns = reject;}
+    void setEventIndexFile(std::string name){eventIndexFileName = name; useEventIndex = true;}
+
+    void buildEventIndex();
+
+    //Event plane recentering/flattening from an in-memory pass over the first nEntries events
+    void setEventPlaneCalibrationEntries(long nEntries){epCalibrationEntries = nEntries;}
+    //Run-independent recentering from the p2Q*_raw profiles of a previous EventPlaneMaker output
+    void setEventPlaneRecenteringFile(std::string name){epRecenteringFileName = name;}
+    //(vz, centrality) bins of the calibration, default 10 vz bins over +-absZVtxMax and the 9 centrality bins
+    void setEventPlaneCalibrationBinning(int nVzBins, const double* vzBins, int nCentBins = 0, const double* centBins = nullptr);
+
+    void setPerfSnapshotInterval(long nEv){perfSnapshotInterval = nEv;}
+    const PerformanceMonitor& getPerformanceMonitor() const {return perfMon;}
+
     void addHist1D(std::string name, std::string title, int nBins, double xMin, double xMax);
     void addHist2D(std::string name, std::string title, int nBinsX, double xMin, double xMax, int nBinsY, double yMin, double yMax);
 
 private:
+    struct IndexedEvent {
+        long long entry;
+        int runId;
+        int eventId;
+        int centbin16;
+        int centbin9;
+        double refMultCorr;
+        double refMultWeight;
+    };
+
     void clear();
     void makeTree();
+    void processEvents(long first, long last);
+    bool makeWorkers();
+    void mergeWorkers();
+    void configureBranches();
+    bool readEventHeader(long ientry);
+    bool selectEvent();
+    bool selectIndexedEvent(const IndexedEvent& ev);
+    bool loadEventIndex();
+    std::string getEventIndexFileName();
+    //Base name and number of entries of every file of the chain, in chain order
+    static void getChainFiles(TChain* chain, std::vector<std::string>& names, std::vector<Long64_t>& entries);
+    void printIOReport();
     void trackLoop();
     void towerLoop();
     void genTrackLoop();
@@ -76,19 +133,25 @@ private:
     void declareEventPlaneHistos();
     void makeEventPlane();
 
-    void fillHist1D(std::string name, double x, double w = 1.0);
-    void fillHist2D(std::string name, double x, double y, double w = 1.0);
-    void fillTrackHistos(StPicoTrack* trk);
-    void fillTowerHistos(double towEt, TVector3& towPos);
+    struct JetHist1D {int var; TH1D* hist;};
+    struct JetHist2D {int varX; int varY; TH2D* hist;};
+
+    void resolveHistograms();
+    void resolveJetHistograms(std::string prefix, std::vector<JetHist1D>& hists1D, std::vector<JetHist2D>& hists2D);
+    TH1D* findHist1D(std::string name);
+    TH2D* findHist2D(std::string name);
+    void fillTrackHistos(size_t itrk);
+    void fillTowerHistos(double towEt, double towEta, double towPhi);
     void fillGenTrackHistos(StPicoMcTrack* trk);
-    void fillJetHistos(JetVector& jet);
-    void fillGenJetHistos(JetVector& jet);
+    void computeJetObservables(JetVector& jet, double* obs);
+    void fillJetHistos(const double* obs);
+    void fillGenJetHistos(const double* obs);
 
     double pi0mass = 0.13957;
 
     std::unique_ptr<StPicoDstReader> picoReader;
-    StPicoDst* picoDst;
-    StPicoEvent* picoEvent;
+    StPicoDst* picoDst = nullptr;
+    StPicoEvent* picoEvent = nullptr;
 
     std::unique_ptr<StRefMultCorr> refMultCorr;
     std::unique_ptr<BEMCLocator> bemcLoc;
@@ -97,6 +160,15 @@ private:
     std::unique_ptr<JetMaker> fjGenMaker;
 
     std::unique_ptr<EventPlaneMaker> epMaker;
+    std::unique_ptr<FlowCumulantMaker> flowMaker;
+    std::shared_ptr<EventPlaneCalibrator> epCalibrator;
+    long epCalibrationEntries = 0;
+    std::string epRecenteringFileName = "";
+    std::vector<double> epCalibrationVzBins;
+    std::vector<double> epCalibrationCentBins;
+    bool epCalibrationPass = false;
+    Long64_t epCalibrationBytesRead = 0; //left out of printIOReport()
+    void calibrateEventPlane();
 
     TClonesArray* eventTreeArray = nullptr;
     TClonesArray* jetTreeArray = nullptr;
@@ -111,11 +183,44 @@ private:
     std::string outFileName = "";
     std::string histOutFileName = "";
     std::string eventPlaneOutFileName = "";
+    std::string perfOutFileName = "";
+    std::string perfSnapshotFileName = "";
 
-    std::vector<double> towerHadCorrSum;
-    std::vector<unsigned int> towerNTracksMatched;
+    PerformanceMonitor perfMon;
+    long perfSnapshotInterval = 0;
+
+    TrackSelector trackSelector;
+    TrackBuffer trackBuffer;
+    BEMCLocator::TowerKinematics towerKinematics;
+    std::vector<double> towerHitEnergy;
+    HadronicCorrection hadCorr;
+    BEMCTowerStatus towerStatus;
+    std::string towerStatusFileName = "";
+    std::string towerGainFileName = "";
 
     long nEvents = 10;
+    long firstEvent = 0;
+
+    bool useTowers = true;
+    bool useMcTracks = false;
+    bool earlyRejection = true;
+    bool rejectBadRuns = true;
+    bool useEventIndex = false;
+    std::string eventIndexFileName = "";
+    std::vector<IndexedEvent> indexedEvents;
+    long nEventsRead = 0;
+    long nEventHeadersRead = 0;
+    long nEventsRejectedEarly = 0;
+    double bytesPerEventAll = 0;
+    double bytesPerEventEnabled = 0;
+    double bytesPerEventHeader = 0;
+    TBranch* eventBranch = nullptr;
+    int eventBranchTreeNumber = -1;
+
+    unsigned int nThreads = 1;
+    bool isWorker = false;
+    std::vector<std::unique_ptr<PicoDstAnalyzer>> workers;
+
     TVector3 pVtx;
     double pVtx_Z = -999;
     double absZVtxMax = 30.0;
@@ -126,10 +231,12 @@ private:
     int ref16 = -1;
     float centrality = -1;
 
-    const int nCentBins9 = 9;
-    double centBins9[10] = {0, 5, 10, 20, 30, 40, 50, 60, 70, 80};
+    static constexpr int nCentBins9 = 9;
+    static constexpr double centBins9[10] = {0, 5, 10, 20, 30, 40, 50, 60, 70, 80};
 
     double genWeight = 1.0;
+    double refMultWeight = 1.0;
+    double refMultCorrValue = -1.0;
     double weight = 1.0;
 
     double ptMin = 0.2;
@@ -139,16 +246,35 @@ private:
     double nHitsRatioMin = 0.52;
     double trkDCAMax = 3.0;
 
-    static std::map<std::string, std::function<double(JetVector&)>> jetVars;
-    static std::map<std::string, std::function<double(StPicoTrack*)>> trackVars;
-    static std::map<std::string, std::function<double(StPicoMcTrack*)>> genTrackVars;
-    static std::map<std::string, std::function<double(double, TVector3&)>> towerVars;
+    enum JetObservable {kJetPt = 0, kJetEta, kJetPhi, kJetNEF, kJetLeSub, kJetPtD, kJetGirth, kNJetObservables};
+    static const char* jetObservableNames[kNJetObservables];
+    typedef double (*TrackVar)(const TrackBuffer&, size_t);
+    typedef double (*GenTrackVar)(StPicoMcTrack*);
+    typedef double (*TowerVar)(double, double, double);
+
+    static std::map<std::string, TrackVar> trackVars;
+    static std::map<std::string, GenTrackVar> genTrackVars;
+    static std::map<std::string, TowerVar> towerVars;
 
     std::map<std::string, TH1D*> hist1D;
     std::map<std::string, TH2D*> hist2D;
 
-    TProfile *pRes22;
-    TProfile *pRes24;
+    //Resolved once in init(), the fill paths only touch booked histograms
+    std::vector<std::pair<TrackVar, TH1D*>> trackHists;
+    std::vector<std::pair<GenTrackVar, TH1D*>> genTrackHists;
+    std::vector<std::pair<TowerVar, TH1D*>> towerHists;
+    std::vector<JetHist1D> jetHists1D;
+    std::vector<JetHist2D> jetHists2D;
+    std::vector<JetHist1D> genJetHists1D;
+    std::vector<JetHist2D> genJetHists2D;
+    TH1D* hCentrality = nullptr;
+    TH1D* hRefMult = nullptr;
+    TH1D* hNJets = nullptr;
+    TH1D* hNGenJets = nullptr;
+
+    TProfile *pRes22 = nullptr;
+    TProfile *pRes24 = nullptr;
+    std::vector<TProfile*> pResHarmonics; //<cos(n(psi_n,A - psi_n,B))> at index n-1
 };
 
 #endif
\ No newline at end of file
@@ -51,6 +51,8 @@
 #include <iostream>
 #include <string>
 #include "StRefMultCorr.h"
+#include "StRefMultCorrTables.h"
+#include "CounterRandom.h"
 #include "TError.h"
 #include "TRandom.h"
 #include "TMath.h"
@@ -61,23 +63,48 @@ using namespace std ;
 
   namespace {
     typedef pair<Double_t, Int_t> keys;
+
+    // Same order as the Flavor enum
+    const Char_t* flavorNames[StRefMultCorr::kNFlavors] = {
+      "refmult", "refmult2", "refmult3", "toftray", "grefmult",
+      "grefmult_P16id", "grefmult_P17id_VpdMB30", "grefmult_P18ih_VpdMB30",
+      "grefmult_P18ih_VpdMB30_AllLumi", "grefmult_P18ih_VpdMB30_AllLumi_MB5sc",
+      "grefmult_VpdMB30", "grefmult_VpdMBnoVtx"
+    };
   }
 
 //______________________________________________________________________________
 // Default constructor
 StRefMultCorr::StRefMultCorr(const TString name)
- : mName(name)
+ : mName(name), mFlavor(getFlavor(name))
 {
-  mRefMult = 0 ;
-  mVz = -9999. ;
-  mRefMult_corr = -1.0 ;
+  mRandom = 0 ;
 
-  // Clear all data members
+  // Reset run and event state
   clear() ;
 
   // Read parameters
-  read() ;
-  readBadRuns() ;
+  shared_ptr<Tables> tables = make_shared<Tables>() ;
+  read(*tables) ;
+  readBadRuns(*tables) ;
+  buildRunIndex(*tables) ;
+  buildParameters(*tables) ;
+  mTables = tables ;
+}
+
+//______________________________________________________________________________
+// Clone, shares the tables of the original
+StRefMultCorr::StRefMultCorr(const TString name, const shared_ptr<const Tables>& tables)
+ : mName(name), mFlavor(getFlavor(name)), mTables(tables)
+{
+  mRandom = 0 ;
+  clear() ;
+}
+
+//______________________________________________________________________________
+StRefMultCorr* StRefMultCorr::clone() const
+{
+  return new StRefMultCorr(mName, mTables) ;
 }
 
 //______________________________________________________________________________
@@ -87,36 +114,53 @@ StRefMultCorr::~StRefMultCorr()
 }
 
 //______________________________________________________________________________
-Int_t StRefMultCorr::getBeginRun(const Double_t energy, const Int_t year)
+StRefMultCorr::Flavor StRefMultCorr::getFlavor(const TString& name)
+{
+  for(Int_t i = 0; i < kNFlavors; i++) {
+    if ( name.CompareTo(flavorNames[i], TString::kIgnoreCase) == 0 ) return static_cast<Flavor>(i) ;
+  }
+  return kNFlavors ;
+}
+
+//______________________________________________________________________________
+const Char_t* StRefMultCorr::getFlavorName(const Flavor flavor)
+{
+  return ( flavor >= 0 && flavor < kNFlavors ) ? flavorNames[flavor] : "" ;
+}
+
+//______________________________________________________________________________
+Int_t StRefMultCorr::getBeginRun(const Double_t energy, const Int_t year) const
 {
+  const multimap<keys, Int_t>& runs = mTables->mBeginRun ;
   keys key(std::make_pair(energy, year));
 
   // Make sure key exists
-  multimap<keys, Int_t>::iterator iterCheck = mBeginRun.find(key);
-  if ( iterCheck == mBeginRun.end() ) {
+  multimap<keys, Int_t>::const_iterator iterCheck = runs.find(key);
+  if ( iterCheck == runs.end() ) {
     Error("StRefMultCorr::getBeginRun", "can't find energy = %1.1f, year = %d", energy, year);
     return -1;
   }
 
-  pair<multimap<keys, Int_t>::iterator, multimap<keys, Int_t>::iterator> iterRange = mBeginRun.equal_range(key);
+  pair<multimap<keys, Int_t>::const_iterator, multimap<keys, Int_t>::const_iterator> iterRange = runs.equal_range(key);
 
   return (*(iterRange.first)).second ;
 }
 
 //______________________________________________________________________________
-Int_t StRefMultCorr::getEndRun(const Double_t energy, const Int_t year)
+Int_t StRefMultCorr::getEndRun(const Double_t energy, const Int_t year) const
 {
+  const multimap<keys, Int_t>& runs = mTables->mEndRun ;
   keys key(std::make_pair(energy, year));
 
   // Make sure key exists
-  multimap<keys, Int_t>::iterator iterCheck = mEndRun.find(key);
-  if ( iterCheck == mEndRun.end() ) {
+  multimap<keys, Int_t>::const_iterator iterCheck = runs.find(key);
+  if ( iterCheck == runs.end() ) {
     Error("StRefMultCorr::getEndRun", "can't find energy = %1.1f, year = %d", energy, year);
     return -1;
   }
 
-  pair<multimap<keys, Int_t>::iterator, multimap<keys, Int_t>::iterator> iterRange = mEndRun.equal_range(key);
-  multimap<keys, Int_t>::iterator iter = iterRange.second ;
+  pair<multimap<keys, Int_t>::const_iterator, multimap<keys, Int_t>::const_iterator> iterRange = runs.equal_range(key);
+  multimap<keys, Int_t>::const_iterator iter = iterRange.second ;
   iter--;
 
   return (*iter).second ;
@@ -125,54 +169,43 @@ Int_t StRefMultCorr::getEndRun(const Double_t energy, const Int_t year)
 //______________________________________________________________________________
 void StRefMultCorr::clear()
 {
-  // Clear all arrays, and set parameter index = -1
-
-  mYear.clear() ;
-  mStart_runId.clear() ;
-  mStop_runId.clear() ;
-  mStart_zvertex.clear() ;
-  mStop_zvertex.clear() ;
-  mNormalize_stop.clear() ;
+  // Reset the event cache and set parameter index = -1
+  //   * The tables are immutable once built, nothing to clear there
+  mRefMult = 0 ;
+  mVz = -9999. ;
+  mZdcCoincidenceRate = 0. ;
+  mKeyedEvent = kFALSE ;
+  mEventRunId = -1 ;
+  mEventId = -1 ;
+  mRefMult_corr = -1.0 ;
 
-  for(Int_t i=0;i<mNCentrality;i++) {
-    mCentrality_bins[i].clear() ;
-  }
   mParameterIndex = -1 ;
+  mCurrentRunId = -1 ;
+  mPar = 0 ;
+}
 
-  for(Int_t i=0;i<mNPar_z_vertex;i++) {
-      mPar_z_vertex[i].clear() ;
-  }
-
-  for(Int_t i=0;i<mNPar_weight;i++) {
-      mPar_weight[i].clear();
-  }
-
-  for(Int_t i=0;i<mNPar_luminosity;i++) {
-      mPar_luminosity[i].clear();
-  }
-
-  mBeginRun.clear() ;
-  mEndRun.clear() ;
-  mBadRun.clear() ;
-
-  mnVzBinForWeight = 0 ;
-  mVzEdgeForWeight.clear();
-  mgRefMultTriggerCorrDiffVzScaleRatio.clear() ;
+//______________________________________________________________________________
+void StRefMultCorr::setTables(const shared_ptr<const Tables>& tables)
+{
+  mTables = tables ;
+  mPar = ( mParameterIndex >= 0 && mParameterIndex < (Int_t)mTables->mParameters.size() ) ? &mTables->mParameters[mParameterIndex] : 0 ;
 }
 
 //______________________________________________________________________________
-Bool_t StRefMultCorr::isBadRun(const Int_t RunId)
+Bool_t StRefMultCorr::isBadRun(const Int_t RunId) const
 {
   // Return true if a given run id is bad run
-  vector<Int_t>::iterator iter = std::find(mBadRun.begin(), mBadRun.end(), RunId);
+  //   * mBadRun is sorted in buildRunIndex()
+  const vector<Int_t>& badRun = mTables->mBadRun ;
+  const Bool_t isBad = std::binary_search(badRun.begin(), badRun.end(), RunId);
 #if 0
-  if ( iter != mBadRun.end() ) {
+  if ( isBad ) {
     // QA
-    cout << "StRefMultCorr::isBadRun  Find bad run = " << (*iter) << endl;
+    cout << "StRefMultCorr::isBadRun  Find bad run = " << RunId << endl;
   }
 #endif
 
-  return ( iter != mBadRun.end() ) ;
+  return isBad ;
 }
 
 //______________________________________________________________________________
@@ -180,7 +213,8 @@ void StRefMultCorr::initEvent(const UShort_t RefMult, const Double_t z, const Do
 {
   // Set refmult, vz and corrected refmult if current (refmult,vz) are different from inputs
   // - User must call this function event-by-event before calling any other public functions
-  if ( mRefMult != RefMult || mVz != z || mZdcCoincidenceRate != zdcCoincidenceRate ) {
+  if ( mKeyedEvent || mRefMult != RefMult || mVz != z || mZdcCoincidenceRate != zdcCoincidenceRate ) {
+    mKeyedEvent         = kFALSE ;
     mRefMult            = RefMult ;
     mVz                 = z ;
     mZdcCoincidenceRate = zdcCoincidenceRate ;
@@ -188,6 +222,23 @@ void StRefMultCorr::initEvent(const UShort_t RefMult, const Double_t z, const Do
   }
 }
 
+//______________________________________________________________________________
+void StRefMultCorr::initEvent(const UShort_t RefMult, const Double_t z, const Double_t zdcCoincidenceRate,
+    const Int_t RunId, const Int_t EventId)
+{
+  // Keyed version of initEvent(), the random sampling over the bin width is fixed by (RunId, EventId)
+  if ( !mKeyedEvent || mEventRunId != RunId || mEventId != EventId
+      || mRefMult != RefMult || mVz != z || mZdcCoincidenceRate != zdcCoincidenceRate ) {
+    mKeyedEvent         = kTRUE ;
+    mEventRunId         = RunId ;
+    mEventId            = EventId ;
+    mRefMult            = RefMult ;
+    mVz                 = z ;
+    mZdcCoincidenceRate = zdcCoincidenceRate ;
+    mRefMult_corr       = getRefMultCorr(mRefMult, mVz, mZdcCoincidenceRate, RunId, EventId) ;
+  }
+}
+
 //______________________________________________________________________________
 Bool_t StRefMultCorr::isIndexOk() const
 {
@@ -202,10 +253,10 @@ Bool_t StRefMultCorr::isIndexOk() const
   }
 
   // Out of bounds
-  if ( mParameterIndex >= (Int_t)mStart_runId.size() ) {
+  if ( mParameterIndex >= (Int_t)mTables->mStart_runId.size() ) {
     Error("StRefMultCorr::isIndexOk",
         Form("mParameterIndex = %d > max number of parameter set = %d. Make sure you put correct index for this energy",
-          mParameterIndex, mStart_runId.size()));
+          mParameterIndex, mTables->mStart_runId.size()));
     return kFALSE ;
   }
 
@@ -216,7 +267,7 @@ Bool_t StRefMultCorr::isIndexOk() const
 Bool_t StRefMultCorr::isZvertexOk() const
 {
   // Primary z-vertex check
-  return ( mVz > mStart_zvertex[mParameterIndex] && mVz < mStop_zvertex[mParameterIndex] ) ;
+  return ( mVz > mPar->startZvertex && mVz < mPar->stopZvertex ) ;
 }
 
 //______________________________________________________________________________
@@ -226,7 +277,7 @@ Bool_t StRefMultCorr::isRefMultOk() const
   if ( !isIndexOk() ) return kFALSE ;
 
   // select 0-80%
-  return (mRefMult_corr > mCentrality_bins[0][mParameterIndex] && mRefMult_corr < mCentrality_bins[mNCentrality][mParameterIndex]);
+  return (mRefMult_corr > mPar->centralityBins[0] && mRefMult_corr < mPar->centralityBins[mNCentrality]);
 }
 
 //______________________________________________________________________________
@@ -240,16 +291,16 @@ Bool_t StRefMultCorr::isCentralityOk(const Int_t icent) const
 
   // Special case
   // 1. 80-100% for icent=-1
-  if ( icent == -1 ) return (mRefMult_corr <= mCentrality_bins[0][mParameterIndex]);
+  if ( icent == -1 ) return (mRefMult_corr <= mPar->centralityBins[0]);
 
   // 2. icent = mNCentrality
-  if ( icent == mNCentrality ) return (mRefMult_corr <= mCentrality_bins[mNCentrality][mParameterIndex]);
+  if ( icent == mNCentrality ) return (mRefMult_corr <= mPar->centralityBins[mNCentrality]);
 
-  const Bool_t ok = (mRefMult_corr > mCentrality_bins[icent][mParameterIndex] && mRefMult_corr <= mCentrality_bins[icent+1][mParameterIndex]);
+  const Bool_t ok = (mRefMult_corr > mPar->centralityBins[icent] && mRefMult_corr <= mPar->centralityBins[icent+1]);
 //  if(ok){
 //    cout << "StRefMultCorr::isCentralityOk  refmultcorr = " << mRefMult_corr
-//      << "  min. bin = " << mCentrality_bins[icent][mParameterIndex]
-//      << "  max. bin = " << mCentrality_bins[icent+1][mParameterIndex]
+//      << "  min. bin = " << mPar->centralityBins[icent]
+//      << "  max. bin = " << mPar->centralityBins[icent+1]
 //      << endl;
 //  }
   return ok ;
@@ -258,6 +309,10 @@ Bool_t StRefMultCorr::isCentralityOk(const Int_t icent) const
 //______________________________________________________________________________
 void StRefMultCorr::init(const Int_t RunId)
 {
+  // Same run as the previous call, parameters are already set
+  if ( RunId == mCurrentRunId ) return ;
+  mCurrentRunId = RunId ;
+
   // Reset mParameterIndex
   mParameterIndex = -1 ;
 
@@ -269,15 +324,14 @@ void StRefMultCorr::init(const Int_t RunId)
 Int_t StRefMultCorr::setParameterIndex(const Int_t RunId)
 {
   // Determine the corresponding parameter set for the input RunId
-  for(UInt_t npar = 0; npar < mStart_runId.size(); npar++)
-  {
-    if(RunId >= mStart_runId[npar] && RunId <= mStop_runId[npar])
-    {
-      mParameterIndex = npar ;
-      //cout << "StRefMultCorr::setParameterIndex  Parameter set = " << mParameterIndex << " for RUN " << RunId << endl;
-      break ;
-    }
+  //   * Binary search over the run intervals built in buildRunIndex()
+  const Tables& t = *mTables ;
+  const UInt_t i = std::upper_bound(t.mRunIndexEdge.begin(), t.mRunIndexEdge.end(), RunId) - t.mRunIndexEdge.begin();
+  if ( i > 0 && i < t.mRunIndexEdge.size() ) {
+    mParameterIndex = t.mRunIndexPar[i-1] ;
+    //cout << "StRefMultCorr::setParameterIndex  Parameter set = " << mParameterIndex << " for RUN " << RunId << endl;
   }
+  mPar = ( mParameterIndex >= 0 && mParameterIndex < (Int_t)t.mParameters.size() ) ? &t.mParameters[mParameterIndex] : 0 ;
 
   if(mParameterIndex == -1){
     Error("StRefMultCorr::setParameterIndex", "Parameter set does not exist for RUN %d", RunId);
@@ -287,6 +341,68 @@ Int_t StRefMultCorr::setParameterIndex(const Int_t RunId)
   return mParameterIndex ;
 }
 
+//______________________________________________________________________________
+void StRefMultCorr::buildRunIndex(Tables& t)
+{
+  // Split the run axis at every start/stop of a parameter set. Each interval keeps the
+  // first parameter set (in file order) covering it, as the linear scan did
+  t.mRunIndexEdge.clear() ;
+  t.mRunIndexPar.clear() ;
+  for(UInt_t npar = 0; npar < t.mStart_runId.size(); npar++) {
+    t.mRunIndexEdge.push_back(t.mStart_runId[npar]);
+    t.mRunIndexEdge.push_back(t.mStop_runId[npar] + 1);
+  }
+  std::sort(t.mRunIndexEdge.begin(), t.mRunIndexEdge.end());
+  t.mRunIndexEdge.erase(std::unique(t.mRunIndexEdge.begin(), t.mRunIndexEdge.end()), t.mRunIndexEdge.end());
+
+  for(UInt_t i = 0; i + 1 < t.mRunIndexEdge.size(); i++) {
+    Int_t index = -1 ;
+    for(UInt_t npar = 0; npar < t.mStart_runId.size(); npar++) {
+      if(t.mRunIndexEdge[i] >= t.mStart_runId[npar] && t.mRunIndexEdge[i] <= t.mStop_runId[npar]) {
+        index = npar ;
+        break ;
+      }
+    }
+    t.mRunIndexPar.push_back(index);
+  }
+
+  std::sort(t.mBadRun.begin(), t.mBadRun.end());
+  t.mBadRun.erase(std::unique(t.mBadRun.begin(), t.mBadRun.end()), t.mBadRun.end());
+}
+
+//______________________________________________________________________________
+void StRefMultCorr::buildParameters(Tables& t) const
+{
+  // Copy the per-parameter-set columns into one block per set and fold the
+  // flavor dependent luminosity normalization in
+  t.mParameters.assign(t.mStart_runId.size(), Parameters());
+  for(UInt_t npar = 0; npar < t.mStart_runId.size(); npar++) {
+    Parameters& par = t.mParameters[npar] ;
+    par.year          = t.mYear[npar] ;
+    par.startZvertex  = t.mStart_zvertex[npar] ;
+    par.stopZvertex   = t.mStop_zvertex[npar] ;
+    par.normalizeStop = t.mNormalize_stop[npar] ;
+    for(Int_t i = 0; i < mNPar_z_vertex; i++) par.zvertex[i] = t.mPar_z_vertex[i][npar] ;
+    for(Int_t i = 0; i < mNPar_weight; i++) par.weight[i] = t.mPar_weight[i][npar] ;
+    for(Int_t i = 0; i < mNCentrality+1; i++) par.centralityBins[i] = t.mCentrality_bins[i][npar] ;
+
+    for(Int_t i = 0; i < mNPar_luminosity; i++) par.luminosity[i] = t.mPar_luminosity[i][npar] ;
+
+    const Double_t par0l = par.luminosity[0] ;
+    const Double_t par1l = par.luminosity[1] ;
+    par.lumiRatio = (par0l==0.0) ? 0.0 : par1l/par0l ;
+    par.lumiScale = 1.0 ;
+    if ( isVpdMBgRefMult(mFlavor) && par0l != 0.0 ) {
+      // from Run14, P16id, for VpdMB5/VPDMB30/VPDMB-noVtx, use refMult at ZdcX=30, other is at ZdcX=0; 
+      //  -->changed by xlchen@lbl.gov, Run16 ~ 50kHz
+      float zdcmean = 0;
+      if(par.year == 2014) zdcmean = 30.;
+      if(par.year == 2016) zdcmean = 50.;
+      par.lumiScale = (par0l+par1l*zdcmean)/par0l ;
+    }
+  }
+}
+
 //______________________________________________________________________________
 Double_t StRefMultCorr::getRefMultCorr() const
 {
@@ -301,50 +417,48 @@ Double_t StRefMultCorr::getRefMultCorr(const UShort_t RefMult, const Double_t z,
   // Apply correction if parameter index & z-vertex are ok
   if (!isIndexOk() || !isZvertexOk()) return RefMult ;
 
+  TRandom* random = (mRandom) ? mRandom : gRandom ;
+  const Double_t RefMult_d = (Double_t)(RefMult)+random->Rndm(); // random sampling over bin width -> avoid peak structures in corrected distribution
+  return correctRefMult(RefMult_d, z, zdcCoincidenceRate, flag);
+}
+
+//______________________________________________________________________________
+Double_t StRefMultCorr::getRefMultCorr(const UShort_t RefMult, const Double_t z,
+    const Double_t zdcCoincidenceRate, const Int_t RunId, const Int_t EventId, const UInt_t flag) const
+{
+  // Apply correction if parameter index & z-vertex are ok
+  if (!isIndexOk() || !isZvertexOk()) return RefMult ;
+
+  // random sampling over bin width, reproducible for a given event
+  const Double_t RefMult_d = (Double_t)(RefMult)+CounterRandom::uniform(RunId, EventId);
+  return correctRefMult(RefMult_d, z, zdcCoincidenceRate, flag);
+}
+
+//______________________________________________________________________________
+Double_t StRefMultCorr::correctRefMult(const Double_t RefMult_d, const Double_t z,
+    const Double_t zdcCoincidenceRate, const UInt_t flag) const
+{
   // Correction function for RefMult, takes into account z_vertex dependence
 
   // Luminosity corrections
   // 200 GeV only. correction = 1 for all the other energies for BES-I
   // the above statement may not true for BES-II, since the luminosity is much higher than BES-I, add by Zaochen
   // better to check the <Refmult> vs ZDCX to see whether they are flat or not, add by Zaochen
-  const Double_t par0l = mPar_luminosity[0][mParameterIndex] ;
-  const Double_t par1l = mPar_luminosity[1][mParameterIndex] ;
-  Double_t correction_luminosity = (par0l==0.0) ? 1.0 : 1.0/(1.0 + par1l/par0l*zdcCoincidenceRate/1000.);
-
-  if(mName.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_P17id_VpdMB30", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_P18ih_VpdMB30", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi_MB5sc", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_VpdMB30", TString::kIgnoreCase) == 0 ||
-     mName.CompareTo("grefmult_VpdMBnoVtx", TString::kIgnoreCase) == 0 ) {
-      float zdcmean = 0;
-      if(mYear[mParameterIndex] == 2014) zdcmean = 30.;
-      if(mYear[mParameterIndex] == 2016) zdcmean = 50.;
-      correction_luminosity = (par0l==0.0) ? correction_luminosity : correction_luminosity*(par0l+par1l*zdcmean)/par0l; 
-      // from Run14, P16id, for VpdMB5/VPDMB30/VPDMB-noVtx, use refMult at ZdcX=30, other is at ZdcX=0; 
-      //  -->changed by xlchen@lbl.gov, Run16 ~ 50kHz
-  }
-
-  // par0 to par5 define the parameters of a polynomial to parametrize z_vertex dependence of RefMult
-  const Double_t par0 = mPar_z_vertex[0][mParameterIndex];
-  const Double_t par1 = mPar_z_vertex[1][mParameterIndex];
-  const Double_t par2 = mPar_z_vertex[2][mParameterIndex];
-  const Double_t par3 = mPar_z_vertex[3][mParameterIndex];
-  const Double_t par4 = mPar_z_vertex[4][mParameterIndex];
-  const Double_t par5 = mPar_z_vertex[5][mParameterIndex];
-  const Double_t par6 = mPar_z_vertex[6][mParameterIndex];
-  const Double_t par7 = mPar_z_vertex[7][mParameterIndex]; // this parameter is usually 0, it takes care for an additional efficiency, usually difference between phase A and phase B parameter 0
-
-  const Double_t  RefMult_ref = par0; // Reference mean RefMult at z=0
-  const Double_t  RefMult_z = par0 + par1*z + par2*z*z + par3*z*z*z + par4*z*z*z*z + par5*z*z*z*z*z + par6*z*z*z*z*z*z; // Parametrization of mean RefMult vs. z_vertex position
+  //   * par0 = 0 gives lumiRatio = 0 and lumiScale = 1, i.e. no correction
+  const Parameters& par = *mPar ;
+  const Double_t correction_luminosity = par.lumiScale/(1.0 + par.lumiRatio*zdcCoincidenceRate/1000.);
+
+  // par0 to par6 define the parameters of a polynomial to parametrize z_vertex dependence of RefMult,
+  // par7 is usually 0, it takes care for an additional efficiency, usually difference between phase A and phase B parameter 0
+  const Double_t* p = par.zvertex ;
+  const Double_t  RefMult_ref = p[0]; // Reference mean RefMult at z=0
+  const Double_t  RefMult_z = p[0] + z*(p[1] + z*(p[2] + z*(p[3] + z*(p[4] + z*(p[5] + z*p[6]))))); // Parametrization of mean RefMult vs. z_vertex position (Horner)
   Double_t  Hovno = 1.0; // Correction factor for RefMult, takes into account z_vertex dependence
   if(RefMult_z > 0.0)
   {
-    Hovno = (RefMult_ref + par7)/RefMult_z;
+    Hovno = (RefMult_ref + p[7])/RefMult_z;
   }
 
-  Double_t RefMult_d = (Double_t)(RefMult)+gRandom->Rndm(); // random sampling over bin width -> avoid peak structures in corrected distribution
   Double_t RefMult_corr  = -9999. ;
   switch ( flag ) {
     case 0: return RefMult_d*correction_luminosity;
@@ -363,6 +477,10 @@ Double_t StRefMultCorr::getRefMultCorr(const UShort_t RefMult, const Double_t z,
 //______________________________________________________________________________
 void StRefMultCorr::readScaleForWeight(const Char_t* input)
 {
+  // Copy on write, clones made before keep the tables they share
+  shared_ptr<Tables> tables = make_shared<Tables>(*mTables) ;
+  Tables& t = *tables ;
+
   ifstream fin(input) ;
   if(!fin) {
     Error("StRefMultCorr::readScaleForWeight", "can't open %s", input);
@@ -370,14 +488,14 @@ void StRefMultCorr::readScaleForWeight(const Char_t* input)
   }
 
   // Users must set the vz bin size by setVzForWeight() (see below)
-  if(mnVzBinForWeight==0) {
+  if(t.mnVzBinForWeight==0) {
     Error("StRefMultCorr::readScaleForWeight",
 	"Please call setVzForWeight() to set vz bin size");
     return;
   }
 
   // Do not allow multiple calls
-  if(!mgRefMultTriggerCorrDiffVzScaleRatio.empty()) {
+  if(!t.mgRefMultTriggerCorrDiffVzScaleRatio.empty()) {
     Error("StRefMultCorr::readScaleForWeight",
 	"scale factor has already set in the array");
     return;
@@ -386,16 +504,17 @@ void StRefMultCorr::readScaleForWeight(const Char_t* input)
   cout << "StRefMultCorr::readScaleForWeight  Read scale factor ..."
     << flush;
   while(fin) {
-    Double_t scale[mnVzBinForWeight] ;
-    for(Int_t i=0; i<mnVzBinForWeight; i++) {
+    Double_t scale[t.mnVzBinForWeight] ;
+    for(Int_t i=0; i<t.mnVzBinForWeight; i++) {
       fin >> scale[i] ;
     }
     if(fin.eof()) break ;
 
-    for(Int_t i=0; i<mnVzBinForWeight; i++) {
-      mgRefMultTriggerCorrDiffVzScaleRatio.push_back(scale[i]);
+    for(Int_t i=0; i<t.mnVzBinForWeight; i++) {
+      t.mgRefMultTriggerCorrDiffVzScaleRatio.push_back(scale[i]);
     }
   }
+  setTables(tables) ;
   cout << " [OK]" << endl;
 }
 
@@ -403,22 +522,27 @@ void StRefMultCorr::readScaleForWeight(const Char_t* input)
 void StRefMultCorr::setVzForWeight(const Int_t nbin, const Double_t min,
     const Double_t max)
 {
+  // Copy on write, clones made before keep the tables they share
+  shared_ptr<Tables> tables = make_shared<Tables>(*mTables) ;
+  Tables& t = *tables ;
+
   // Do not allow multiple calls
-  if(!mVzEdgeForWeight.empty()) {
+  if(!t.mVzEdgeForWeight.empty()) {
     Error("StRefMultCorr::setVzForWeight",
 	"z-vertex range for weight has already been defined");
     return;
   }
 
-  mnVzBinForWeight = nbin ;
+  t.mnVzBinForWeight = nbin ;
   // calculate increment size
   const Double_t step = (max-min)/(Double_t)nbin;
-  for(Int_t i=0; i<mnVzBinForWeight+1; i++) {
-    mVzEdgeForWeight.push_back( min + step*i );
+  for(Int_t i=0; i<t.mnVzBinForWeight+1; i++) {
+    t.mVzEdgeForWeight.push_back( min + step*i );
   }
+  setTables(tables) ;
   // Debug
-  for(Int_t i=0; i<mnVzBinForWeight; i++) {
-    cout << i << " " << step << " " << mVzEdgeForWeight[i] << ", " << mVzEdgeForWeight[i+1] << endl;
+  for(Int_t i=0; i<t.mnVzBinForWeight; i++) {
+    cout << i << " " << step << " " << t.mVzEdgeForWeight[i] << ", " << t.mVzEdgeForWeight[i+1] << endl;
   }
 }
 
@@ -427,16 +551,17 @@ Double_t StRefMultCorr::getScaleForWeight() const
 {
   // Special scale factor for global refmult in Run14 to account for the difference between 
   // VPDMB-30 and VPDMB-5
+  const Tables& t = *mTables ;
 
   // return 1 if mgRefMultTriggerCorrDiffVzScaleRatio array is empty
-  if(mgRefMultTriggerCorrDiffVzScaleRatio.empty()) return 1.0 ;
+  if(t.mgRefMultTriggerCorrDiffVzScaleRatio.empty()) return 1.0 ;
 
 //  const Int_t nVzBins = 6;
 //  Double_t VzEdge[nVzBins+1] = {-6., -4., -2., 0., 2., 4., 6.};
   Double_t VPD5weight = 1.0;
 
-  for(Int_t j = 0; j < mnVzBinForWeight; j++) {
-    if(mVz > mVzEdgeForWeight[j] && mVz <= mVzEdgeForWeight[j+1]) {
+  for(Int_t j = 0; j < t.mnVzBinForWeight; j++) {
+    if(mVz > t.mVzEdgeForWeight[j] && mVz <= t.mVzEdgeForWeight[j+1]) {
 /*
       //=== OLD StRefMultCorr code... ===//      
 
@@ -453,27 +578,21 @@ Double_t StRefMultCorr::getScaleForWeight() const
 */
       
       const Int_t refMultbin = static_cast<Int_t>(mRefMult_corr);
-      VPD5weight = mgRefMultTriggerCorrDiffVzScaleRatio[refMultbin*mnVzBinForWeight + j];
+      VPD5weight = t.mgRefMultTriggerCorrDiffVzScaleRatio[refMultbin*t.mnVzBinForWeight + j];
       const Double_t tmpContent = VPD5weight;
 
       // OLD CORRECTION!
-      if(mName.CompareTo("grefmult", TString::kIgnoreCase) == 0) {
+      if(mFlavor == kgRefMult) {
         if(tmpContent == 0 || (mRefMult_corr > 500 && tmpContent <= 0.65)) VPD5weight = 1.15; // Just because the value of the weight is around 1.15
         if(mRefMult_corr > 500 && tmpContent >= 1.35) VPD5weight = 1.15;                      // Remove those Too large weight factor, gRefmult > 500
         // this weight and reweight should be careful, after reweight (most peripheral), Then weight (whole range)
       }
-      if(mName.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0) {
+      if(mFlavor == kgRefMult_P16id) {
         if(VPD5weight == 0) VPD5weight = 1;
       }
 
       // NEW CORRECTION
-      if(mName.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_P17id_VpdMB30", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_P18ih_VpdMB30", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi_MB5sc", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_VpdMB30", TString::kIgnoreCase) == 0 ||
-         mName.CompareTo("grefmult_VpdMBnoVtx", TString::kIgnoreCase) == 0 ) {
+      if(isVpdMBgRefMult(mFlavor)) {
 
          // 1) Ratios fluctuate too much at very high gRefmult due to low statistics
          // 2) Avoid some events with too high weight
@@ -502,30 +621,23 @@ Double_t StRefMultCorr::getWeight() const
   // Invalid z-vertex
   if( !isZvertexOk() ) return Weight;
 
-  const Double_t par0 =   mPar_weight[0][mParameterIndex];
-  const Double_t par1 =   mPar_weight[1][mParameterIndex];
-  const Double_t par2 =   mPar_weight[2][mParameterIndex];
-  const Double_t par3 =   mPar_weight[3][mParameterIndex];
-  const Double_t par4 =   mPar_weight[4][mParameterIndex];
-  const Double_t A    =   mPar_weight[5][mParameterIndex];
-  const Double_t par6 =   mPar_weight[6][mParameterIndex];//Add by guannan for run14
-  const Double_t par7 =   mPar_weight[7][mParameterIndex];//Add by guannan for run14
+  const Double_t* p = mPar->weight ;
+  // p[5] is the z-vertex dependent correction A, p[6] and p[7] were added by guannan for run14
 
   // Additional z-vertex dependent correction
   //const Double_t A = ((1.27/1.21))/(30.0*30.0); // Don't ask...
   //const Double_t A = (0.05/0.21)/(30.0*30.0); // Don't ask...
 
   if(isRefMultOk() // 0-80%
-      && mRefMult_corr < mNormalize_stop[mParameterIndex] // re-weighting only apply up to normalization point
-      && mRefMult_corr != -(par3/par2) // avoid denominator = 0
+      && mRefMult_corr < mPar->normalizeStop // re-weighting only apply up to normalization point
+      && mRefMult_corr != -(p[3]/p[2]) // avoid denominator = 0
     )
   {
-    Weight = par0
-             + par1/(par2*mRefMult_corr + par3) 
-             + par4*(par2*mRefMult_corr + par3) 
-             + par6/TMath::Power(par2*mRefMult_corr+par3, 2) 
-             + par7*TMath::Power(par2*mRefMult_corr+par3, 2); // Parametrization of MC/data RefMult ratio
-    Weight = Weight + (Weight-1.0)*(A*mVz*mVz); // z-dependent weight correction
+    // Parametrization of MC/data RefMult ratio, p0 + p1/x + p4*x + p6/x^2 + p7*x^2 with x = p2*refmult + p3
+    const Double_t x   = p[2]*mRefMult_corr + p[3] ;
+    const Double_t inv = 1.0/x ;
+    Weight = p[0] + inv*(p[1] + inv*p[6]) + x*(p[4] + x*p[7]);
+    Weight = Weight + (Weight-1.0)*(p[5]*mVz*mVz); // z-dependent weight correction
   }
 
   //------------for Run14 and Run16----------------
@@ -540,91 +652,99 @@ Double_t StRefMultCorr::getWeight() const
 }
 
 //______________________________________________________________________________
-Int_t StRefMultCorr::getCentralityBin16() const
+Int_t StRefMultCorr::findCentralityBin16(const Double_t refMultCorr) const
 {
-  Int_t CentBin16 = -1;
+  // Number of edges below refMultCorr, the bin is (edge[i] , edge[i+1]]
+  //  - 0 edges below: 80-100%, 17 edges below: refmult > 5000, both return -1
+  const Int_t* edge = mPar->centralityBins ;
+  Int_t base = 0 ;
+  Int_t n = mNCentrality+1 ;
+  while ( n > 1 ) {
+    const Int_t half = n/2 ;
+    base = (edge[base+half] < refMultCorr) ? base+half : base ;
+    n -= half ;
+  }
+  const Int_t nBelow = base + (edge[base] < refMultCorr) ;
+  return (nBelow == 0 || nBelow == mNCentrality+1) ? -1 : nBelow-1 ;
+}
 
+//______________________________________________________________________________
+Int_t StRefMultCorr::getCentralityBin16() const
+{
   // Invalid index
-  if( !isIndexOk() ) return CentBin16;
+  if( !isIndexOk() ) return -1;
 
-  while(CentBin16 < mNCentrality && !isCentralityOk(CentBin16) )
-  {
-    CentBin16++;
-  }
-
-  // return -1 if CentBin16 = 16 (very large refmult, refmult>5000)
-  return (CentBin16==16) ? -1 : CentBin16;
+  return findCentralityBin16(mRefMult_corr);
 }
 
 //______________________________________________________________________________
 Int_t StRefMultCorr::getCentralityBin9() const
 {
-  Int_t CentBin9 = -1;
-
   // Invalid index
-  if ( !isIndexOk() ) return CentBin9 ;
+  if ( !isIndexOk() ) return -1 ;
 
-  const Int_t CentBin16 = getCentralityBin16(); // Centrality bin 16
-  const Bool_t isCentralityOk = CentBin16 >= 0 && CentBin16 < mNCentrality ;
-
-  // No centrality is defined
-  if (!isCentralityOk) return CentBin9 ;
+  // 0-5% and 5-10% keep their own bins, 10% increments otherwise
+  return toCentralityBin9(findCentralityBin16(mRefMult_corr));
+}
 
-  // First handle the exceptions
-  if(mRefMult_corr > mCentrality_bins[15][mParameterIndex] && mRefMult_corr <= mCentrality_bins[16][mParameterIndex])
-  {
-    CentBin9 = 8; // most central 5%
-  }
-  else if(mRefMult_corr > mCentrality_bins[14][mParameterIndex] && mRefMult_corr <= mCentrality_bins[15][mParameterIndex])
-  {
-    CentBin9 = 7; // most central 5-10%
-  }
-  else
-  {
-    CentBin9 = (Int_t)(0.5*CentBin16);
+//______________________________________________________________________________
+void StRefMultCorr::getCentrality(const Int_t RunId, const Int_t n, const UShort_t* RefMult, const Double_t* z,
+    const Double_t* zdcCoincidenceRate, Double_t* refMultCorr, Int_t* bin16, Int_t* bin9, Double_t* weight,
+    const Int_t* EventId)
+{
+  init(RunId);
+  // Invalid index (stops the process as in the per-event functions)
+  if ( n <= 0 || !isIndexOk() ) return ;
+
+  for(Int_t i = 0; i < n; i++) {
+    if ( EventId ) initEvent(RefMult[i], z[i], zdcCoincidenceRate[i], RunId, EventId[i]);
+    else initEvent(RefMult[i], z[i], zdcCoincidenceRate[i]);
+    const Int_t cent16 = findCentralityBin16(mRefMult_corr);
+    if ( refMultCorr ) refMultCorr[i] = mRefMult_corr ;
+    if ( bin16 ) bin16[i] = cent16 ;
+    if ( bin9 ) bin9[i] = toCentralityBin9(cent16) ;
+    if ( weight ) weight[i] = getWeight() ;
   }
-
-  return CentBin9;
 }
 
 //______________________________________________________________________________
 const Char_t* StRefMultCorr::getTable() const
 {
   if ( mName.CompareTo("refmult", TString::kIgnoreCase) == 0 ) {
-    return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_refmult.txt";
+    return "Centrality_def_refmult.txt";
   }
   else if ( mName.CompareTo("refmult2", TString::kIgnoreCase) == 0 ) {
-    return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_refmult2.txt";
+    return "Centrality_def_refmult2.txt";
   }
   else if ( mName.CompareTo("refmult3", TString::kIgnoreCase) == 0 ) {
-    return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_refmult3.txt";
+    return "Centrality_def_refmult3.txt";
   }
   else if ( mName.CompareTo("toftray", TString::kIgnoreCase) == 0 ) {
-    return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_toftray.txt";
+    return "Centrality_def_toftray.txt";
   }
   else if ( mName.CompareTo("grefmult", TString::kIgnoreCase) == 0 ) {
-    return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult.txt";
+    return "Centrality_def_grefmult.txt";
   }
   else if ( mName.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_P16id.txt";
+      return "Centrality_def_grefmult_P16id.txt";
   }
   else if ( mName.CompareTo("grefmult_P17id_VpdMB30", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_P17id_VpdMB30.txt";
+      return "Centrality_def_grefmult_P17id_VpdMB30.txt";
   }
   else if ( mName.CompareTo("grefmult_P18ih_VpdMB30", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_P18ih_VpdMB30.txt";
+      return "Centrality_def_grefmult_P18ih_VpdMB30.txt";
   }
   else if ( mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_P18ih_VpdMB30_AllLumi.txt";
+      return "Centrality_def_grefmult_P18ih_VpdMB30_AllLumi.txt";
   }
   else if ( mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi_MB5sc", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_P18ih_VpdMB30_AllLumi.txt";
+      return "Centrality_def_grefmult_P18ih_VpdMB30_AllLumi.txt";
   }
   else if ( mName.CompareTo("grefmult_VpdMB30", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_VpdMB30.txt";
+      return "Centrality_def_grefmult_VpdMB30.txt";
   }
   else if ( mName.CompareTo("grefmult_VpdMBnoVtx", TString::kIgnoreCase) == 0 ) {
-      return "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/Centrality_def_grefmult_VpdMBnoVtx.txt";
+      return "Centrality_def_grefmult_VpdMBnoVtx.txt";
   }
   else{
     Error("StRefMultCorr::getTable", "No implementation for %s", mName.Data());
@@ -633,13 +753,76 @@ const Char_t* StRefMultCorr::getTable() const
   }
 }
 //______________________________________________________________________________
-void StRefMultCorr::read()
+TString& StRefMultCorr::inputDirectory()
 {
+  static TString dir ;
+  return dir ;
+}
+
+//______________________________________________________________________________
+void StRefMultCorr::setInputDirectory(const TString& dir)
+{
+  inputDirectory() = dir ;
+}
+
+//______________________________________________________________________________
+const TString& StRefMultCorr::getInputDirectory()
+{
+  return inputDirectory() ;
+}
+
+//______________________________________________________________________________
+void StRefMultCorr::addParameterSet(Tables& t, const Double_t* row)
+{
+  // Year Energy Start_runId Stop_runId Start_z_vertex Stop_z_vertex, centrality bins,
+  // Normalize_stop, z-vertex, weight and luminosity parameters
+  const Int_t year = static_cast<Int_t>(row[0]) ;
+  const Double_t energy = row[1] ;
+  const Int_t startRunId = static_cast<Int_t>(row[2]) ;
+  const Int_t stopRunId = static_cast<Int_t>(row[3]) ;
+  row += 4 ;
+
+  t.mYear.push_back(year) ;
+  t.mBeginRun.insert(std::make_pair(std::make_pair(energy, year), startRunId));
+  t.mEndRun.insert(std::make_pair(std::make_pair(energy, year), stopRunId));
+
+  t.mStart_runId.push_back( startRunId ) ;
+  t.mStop_runId.push_back( stopRunId ) ;
+  t.mStart_zvertex.push_back( *row++ ) ;
+  t.mStop_zvertex.push_back( *row++ ) ;
+  for(Int_t i=0;i<mNCentrality;i++) t.mCentrality_bins[i].push_back( static_cast<Int_t>(*row++) );
+  t.mNormalize_stop.push_back( *row++ );
+  for(Int_t i=0;i<mNPar_z_vertex;i++) t.mPar_z_vertex[i].push_back( *row++ );
+  for(Int_t i=0;i<mNPar_weight;i++) t.mPar_weight[i].push_back( *row++ );
+  for(Int_t i=0;i<mNPar_luminosity;i++) t.mPar_luminosity[i].push_back( *row++ );
+  t.mCentrality_bins[mNCentrality].push_back( 5000 );
+}
+
+//______________________________________________________________________________
+void StRefMultCorr::read(Tables& t) const
+{
+  static_assert(StRefMultCorrTables::nColumns == 6 + mNCentrality + 1 + mNPar_z_vertex + mNPar_weight + mNPar_luminosity,
+      "StRefMultCorrTables::nColumns does not match the Centrality_def format");
+  const Char_t* tableName(getTable());
+
+  // Compiled-in table
+  if ( getInputDirectory().IsNull() ) {
+    const StRefMultCorrTables::CentralityDef* def = StRefMultCorrTables::findCentralityDef(tableName);
+    if ( !def ) {
+      Error("StRefMultCorr::read", "no compiled-in table %s, regenerate StRefMultCorrTables.cpp or use setInputDirectory()", tableName);
+      return;
+    }
+    for(Int_t i = 0; i < def->nRows; i++) {
+      addParameterSet(t, def->values + i*StRefMultCorrTables::nColumns);
+    }
+    return;
+  }
+
   // Open the parameter file and read the data
-  const Char_t* inputFileName(getTable());
-  ifstream ParamFile(inputFileName);
+  const TString inputFileName = getInputDirectory() + "/" + tableName ;
+  ifstream ParamFile(inputFileName.Data());
   if(!ParamFile){
-    Error("StRefMultCorr::read", "cannot open %s", inputFileName);
+    Error("StRefMultCorr::read", "cannot open %s", inputFileName.Data());
     return;
   }
   cout << "StRefMultCorr::read  Open " << inputFileName << flush ;
@@ -651,48 +834,13 @@ void StRefMultCorr::read()
   {
     while(ParamFile.good())
     {
-      Int_t year;
-      Double_t energy;
-      ParamFile >> year >> energy ;
-      Int_t startRunId=0, stopRunId=0 ;
-      Double_t startZvertex=-9999., stopZvertex=-9999. ;
-      ParamFile >> startRunId >> stopRunId >> startZvertex >> stopZvertex ;
+      Double_t row[StRefMultCorrTables::nColumns] ;
+      for(Int_t i=0;i<6;i++) ParamFile >> row[i] ;
       // Error check
       if(ParamFile.eof()) break;
 
-      mYear.push_back(year) ;
-      mBeginRun.insert(std::make_pair(std::make_pair(energy, year), startRunId));
-      mEndRun.insert(std::make_pair(std::make_pair(energy, year), stopRunId));
-
-      mStart_runId.push_back( startRunId ) ;
-      mStop_runId.push_back( stopRunId ) ;
-      mStart_zvertex.push_back( startZvertex ) ;
-      mStop_zvertex.push_back( stopZvertex ) ;
-      for(Int_t i=0;i<mNCentrality;i++) {
-	Int_t centralitybins=-1;
-	ParamFile >> centralitybins;
-	mCentrality_bins[i].push_back( centralitybins );
-      }
-      Double_t normalize_stop=-1.0 ;
-      ParamFile >> normalize_stop ;
-      mNormalize_stop.push_back( normalize_stop );
-      for(Int_t i=0;i<mNPar_z_vertex;i++) {
-	Double_t param=-9999.;
-	ParamFile >> param;
-	mPar_z_vertex[i].push_back( param );
-      }
-      for(Int_t i=0;i<mNPar_weight;i++) {
-	Double_t param=-9999.;
-	ParamFile >> param;
-	mPar_weight[i].push_back( param );
-      }
-
-      for(Int_t i=0;i<mNPar_luminosity;i++) {
-	Double_t param=-9999.;
-	ParamFile >> param;
-	mPar_luminosity[i].push_back( param );
-      }
-      mCentrality_bins[mNCentrality].push_back( 5000 );
+      for(Int_t i=6;i<StRefMultCorrTables::nColumns;i++) ParamFile >> row[i] ;
+      addParameterSet(t, row);
     }
   }
   else
@@ -707,33 +855,38 @@ void StRefMultCorr::read()
 }
 
 //______________________________________________________________________________
-void StRefMultCorr::readBadRuns()
+void StRefMultCorr::readBadRuns(Tables& t) const
 {
   // Read bad run numbers - this is done outside of the StRefMultCorr framework
   //   - From year 2010 - 2016
   //   - If input file doesn't exist, skip to the next year without warning
+  const Char_t* suffix = "" ;
+  switch ( mFlavor ) {
+    case kgRefMult_P16id:                 suffix = "_P16id" ; break ; // read bad runs for VPDMB5
+    case kgRefMult_P17id_VpdMB30:         suffix = "_P17id_VpdMB30" ; break ;
+    case kgRefMult_P18ih_VpdMB30:         suffix = "_P18ih_VpdMB30" ; break ;
+    case kgRefMult_P18ih_VpdMB30_AllLumi: suffix = "_P18ih_VpdMB30_AllLumi" ; break ; // All luminosities
+    case kgRefMult_VpdMB30:               suffix = "_VpdMB30" ; break ;
+    case kgRefMult_VpdMBnoVtx:            suffix = "_VpdMBnoVtx" ; break ;
+    default: break ;
+  }
+
   for(Int_t i=0; i<7; i++) {
-    cout << "StRefMultCorr::readBadRuns  For " << mName << ": open " << flush ;
     const Int_t year = 2010 + i ;
-    Char_t* inputFileName(Form("/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d.txt", year));
-    if(mName.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0) //read bad runs for VPDMB5
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_P16id.txt", year);
-    else if(mName.CompareTo("grefmult_P17id_VpdMB30", TString::kIgnoreCase) == 0) //read bad runs for P17id, VPDMB30
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_P17id_VpdMB30.txt", year);
-    else if(mName.CompareTo("grefmult_P18ih_VpdMB30", TString::kIgnoreCase) == 0) //read bad runs for P18ih, VPDMB30
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_P18ih_VpdMB30.txt", year);
-    else if(mName.CompareTo("grefmult_P18ih_VpdMB30_AllLumi", TString::kIgnoreCase) == 0) //read bad runs for P18ih, VPDMB30, All luminosities
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_P18ih_VpdMB30_AllLumi.txt", year);
-    else if(mName.CompareTo("grefmult_VpdMB30", TString::kIgnoreCase) == 0) //read bad runs for VPDMB30
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_VpdMB30.txt", year);
-    else if(mName.CompareTo("grefmult_VpdMBnoVtx", TString::kIgnoreCase) == 0) //read bad runs for VPDMB-noVtx
-        sprintf(inputFileName, "/Users/tanmaypani/AuAu_Analysis_/MACROS/PicoDstAnalyzer/StRefMultCorrFiles/bad_runs_refmult_year%d_VpdMBnoVtx.txt", year);
-    else
-        ;//
-    cout << "bad run file: " << inputFileName << endl;
-    ifstream fin(inputFileName);
+    const TString fileName = Form("bad_runs_refmult_year%d%s.txt", year, suffix) ;
+
+    // Compiled-in list
+    if ( getInputDirectory().IsNull() ) {
+      const StRefMultCorrTables::BadRuns* badRuns = StRefMultCorrTables::findBadRuns(fileName.Data());
+      if ( badRuns ) t.mBadRun.insert(t.mBadRun.end(), badRuns->runs, badRuns->runs + badRuns->nRuns);
+      continue;
+    }
+
+    const TString inputFileName = getInputDirectory() + "/" + fileName ;
+    cout << "StRefMultCorr::readBadRuns  For " << mName << ": open " << flush ;
+    ifstream fin(inputFileName.Data());
     if(!fin){
-      //      Error("StRefMultCorr::readBadRuns", "can't open %s", inputFileName);
+      //      Error("StRefMultCorr::readBadRuns", "can't open %s", inputFileName.Data());
       cout << endl;
       continue;
     }
@@ -741,7 +894,7 @@ void StRefMultCorr::readBadRuns()
 
     Int_t runId = 0 ;
     while( fin >> runId ) {
-      mBadRun.push_back(runId);
+      t.mBadRun.push_back(runId);
     }
     cout << " [OK]" << endl;
   }
@@ -750,20 +903,22 @@ void StRefMultCorr::readBadRuns()
 //______________________________________________________________________________
 void StRefMultCorr::print(const Option_t* option) const
 {
+  const Tables& t = *mTables ;
+
   cout << "StRefMultCorr::print  Print input parameters for " << mName << " ========================================" << endl << endl;
   // Option switched off, can be used to specify parameters
   //  const TString opt(option);
 
   //  Int_t input_counter = 0;
-  for(UInt_t id = 0; id < mStart_runId.size(); id++) {
+  for(UInt_t id = 0; id < t.mStart_runId.size(); id++) {
     //cout << "Data line = " << input_counter << ", Start_runId = " << Start_runId[input_counter] << ", Stop_runId = " << Stop_runId[input_counter] << endl;
     //    const UInt_t id = mStart_runId.size()-1;
 
     // Removed line break
     cout << "  Index=" << id;
-    cout << Form(" Run=[%8d, %8d]", mStart_runId[id], mStop_runId[id]);
-    cout << Form(" z-vertex=[%1.1f, %1.1f]", mStart_zvertex[id], mStop_zvertex[id]);
-    cout << ", Normalize_stop=" << mNormalize_stop[id];
+    cout << Form(" Run=[%8d, %8d]", t.mStart_runId[id], t.mStop_runId[id]);
+    cout << Form(" z-vertex=[%1.1f, %1.1f]", t.mStart_zvertex[id], t.mStop_zvertex[id]);
+    cout << ", Normalize_stop=" << t.mNormalize_stop[id];
     cout << endl;
 
     //    if(opt.IsWhitespace()){
@@ -779,21 +934,21 @@ void StRefMultCorr::print(const Option_t* option) const
     for(Int_t i = 0; i < mNCentrality; i++){
       //      cout << Form("StRefMultCorr::read  Centrality %3d-%3d %%, refmult > %4d", 75-5*i, 80-5*i, mCentrality_bins[i][id]) << endl;
       const TString tmp(">");
-      const TString centrality = tmp + Form("%d", mCentrality_bins[i][id]);
+      const TString centrality = tmp + Form("%d", t.mCentrality_bins[i][id]);
       cout << Form("%6s", centrality.Data());
     }
     cout << endl;
 
     for(Int_t i = 0; i < mNPar_z_vertex; i++) {
-      cout << "  mPar_z_vertex[" << i << "] = " << mPar_z_vertex[i][id];
+      cout << "  mPar_z_vertex[" << i << "] = " << t.mPar_z_vertex[i][id];
     }
     cout << endl;
     for(Int_t i = 0; i < mNPar_weight; i++) {
-      cout << "  mPar_weight[" << i << "] = " << mPar_weight[i][id];
+      cout << "  mPar_weight[" << i << "] = " << t.mPar_weight[i][id];
     }
     cout << endl;
     for(Int_t i = 0; i < mNPar_luminosity; i++) {
-      cout << "  mPar_luminosity[" << i << "] = " << mPar_luminosity[i][id];
+      cout << "  mPar_luminosity[" << i << "] = " << t.mPar_luminosity[i][id];
     }
     cout << endl << endl;
   }
@@ -805,5 +960,5 @@ void StRefMultCorr::print(const Option_t* option) const
 //___________________________________________________________________________________
 Double_t StRefMultCorr::get(const Int_t i, const Int_t j) const
 {
-  return mgRefMultTriggerCorrDiffVzScaleRatio[j*mnVzBinForWeight+i];
+  return mTables->mgRefMultTriggerCorrDiffVzScaleRatio[j*mTables->mnVzBinForWeight+i];
 }
@@ -65,8 +65,11 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include "TString.h"
 
+class TRandom ;
+
 //______________________________________________________________________________
 // Class to correct z-vertex dependence, luminosity dependence of multiplicity
 class StRefMultCorr {
@@ -80,8 +83,40 @@ class StRefMultCorr {
     StRefMultCorr(const TString name="refmult");
     virtual ~StRefMultCorr(); /// Default destructor
 
+    // New instance sharing the parsed (read-only) tables, with its own run and event state
+    //   * No file is read, use one clone per thread for concurrent event loops
+    StRefMultCorr* clone() const ;
+
+    // Multiplicity definition (table) resolved once from the name, so that the
+    // per-event functions do not compare strings
+    enum Flavor {
+      kRefMult = 0, kRefMult2, kRefMult3, kTofTray, kgRefMult,
+      kgRefMult_P16id, kgRefMult_P17id_VpdMB30, kgRefMult_P18ih_VpdMB30,
+      kgRefMult_P18ih_VpdMB30_AllLumi, kgRefMult_P18ih_VpdMB30_AllLumi_MB5sc,
+      kgRefMult_VpdMB30, kgRefMult_VpdMBnoVtx,
+      kNFlavors
+    };
+    static Flavor getFlavor(const TString& name) ; /// kNFlavors if the name is unknown
+    static const Char_t* getFlavorName(const Flavor flavor) ; /// Name accepted by the constructor
+    Flavor getFlavor() const { return mFlavor ; }
+
+    // Correction parameters of one run range in one flat block, selected by init()
+    struct Parameters {
+      Int_t    year ;
+      Double_t startZvertex ;
+      Double_t stopZvertex ;
+      Double_t normalizeStop ;
+      Double_t zvertex[8] ;    /// z-vertex polynomial (0-6) and efficiency offset (7)
+      Double_t weight[8] ;     /// MC/data re-weighting
+      Double_t luminosity[2] ; /// luminosity correction (200 GeV)
+      Double_t lumiRatio ;     /// par1/par0 of the luminosity correction, 0 if par0 = 0
+      Double_t lumiScale ;     /// normalization to the mean ZDC rate (Run14/16 gRefMult), 1 otherwise
+      Int_t    centralityBins[17] ;
+    };
+    const Parameters* getParameters() const { return mPar ; } /// null before a valid init()
+
     // Bad run rejection
-    Bool_t isBadRun(const Int_t RunId) ;
+    Bool_t isBadRun(const Int_t RunId) const ;
 
     // Event-by-event initialization. Call this function event-by-event
     //   * Default ZDC coincidence rate = 0 to make the function backward compatible 
@@ -89,6 +124,11 @@ class StRefMultCorr {
     void initEvent(const UShort_t RefMult, const Double_t z,
         const Double_t zdcCoincidenceRate=0.0) ; // Set multiplicity, vz and zdc coincidence rate
 
+    // Same with the smearing keyed by (RunId, EventId) instead of drawn from a generator:
+    // the corrected multiplicity of an event does not depend on the processing order or thread
+    void initEvent(const UShort_t RefMult, const Double_t z, const Double_t zdcCoincidenceRate,
+        const Int_t RunId, const Int_t EventId) ;
+
     /// Get corrected multiplicity, correction as a function of primary z-vertex
     Double_t getRefMultCorr() const;
 
@@ -98,6 +138,9 @@ class StRefMultCorr {
     // flag=2:  full correction (default)
     Double_t getRefMultCorr(const UShort_t RefMult, const Double_t z,
        	const Double_t zdcCoincidenceRate, const UInt_t flag=2) const ;
+    // Smearing from the counter-based generator keyed by (RunId, EventId), see CounterRandom.h
+    Double_t getRefMultCorr(const UShort_t RefMult, const Double_t z,
+       	const Double_t zdcCoincidenceRate, const Int_t RunId, const Int_t EventId, const UInt_t flag=2) const ;
 
     /// Get 16 centrality bins (5% increment, 0-5, 5-10, ..., 75-80)
     Int_t getCentralityBin16() const;
@@ -105,10 +148,21 @@ class StRefMultCorr {
     /// Get 9 centrality bins (10% increment except for 0-5 and 5-10)
     Int_t getCentralityBin9() const;
 
+    // Batch evaluation for n events of the same run
+    //   * Calls init(RunId), then gives the same results (and random number sequence) as
+    //     initEvent() followed by getRefMultCorr(), getCentralityBin16(), getCentralityBin9()
+    //     and getWeight() for every event
+    //   * Output arrays may be null if not needed
+    //   * With EventId the smearing is keyed by (RunId, EventId[i]) as in the keyed initEvent()
+    void getCentrality(const Int_t RunId, const Int_t n, const UShort_t* RefMult, const Double_t* z,
+        const Double_t* zdcCoincidenceRate, Double_t* refMultCorr, Int_t* bin16, Int_t* bin9, Double_t* weight,
+        const Int_t* EventId=0) ;
+
     /// Re-weighting correction, correction is only applied up to mNormalize_step (energy dependent)
     Double_t getWeight() const;
 
     // Initialization of centrality bins etc
+    //   * Consecutive calls with the same run id return immediately
     void init(const Int_t RunId);
 
     // Read scale factor from text file
@@ -119,70 +173,118 @@ class StRefMultCorr {
     Double_t get(const Int_t i, const Int_t j) const;
 
     // Return begin/end run from energy and year
-    Int_t getBeginRun(const Double_t energy, const Int_t year) ;
-    Int_t getEndRun(const Double_t energy, const Int_t year) ;
+    Int_t getBeginRun(const Double_t energy, const Int_t year) const ;
+    Int_t getEndRun(const Double_t energy, const Int_t year) const ;
 
     // Print all parameters
     void print(const Option_t* option="") const ;
 
+    // Input tables
+    //   * By default the tables compiled in from StRefMultCorrFiles/ are used (StRefMultCorrTables.h),
+    //     no file is opened
+    //   * With an input directory, Centrality_def_*.txt and bad_runs_refmult_year*.txt are read
+    //     from there instead, for instances constructed afterwards (an empty name goes back to
+    //     the compiled-in tables). Set it before the first CentralityMaker request
+    static void setInputDirectory(const TString& dir) ;
+    static const TString& getInputDirectory() ;
+
+    // Multiplicity definition this instance was built for
+    const TString& getName() const { return mName ; }
+
+    // Random generator used to smear the integer multiplicity (default gRandom) when the
+    // event is not keyed. Give every thread its own generator when running concurrent event loops
+    void setRandom(TRandom* random) { mRandom = random ; }
+
   private:
+    // Data members
+    enum {
+        mNCentrality   = 16, /// 16 centrality bins, starting from 75-80% with 5% bin width
+        mNPar_z_vertex = 8,
+        mNPar_weight   = 8,
+        mNPar_luminosity = 2
+    };
+
+    // Everything read from the input files, built once in the constructor and shared
+    // read-only between clones
+    struct Tables {
+      std::vector<Int_t> mYear              ; /// Year
+      std::vector<Int_t> mStart_runId       ; /// Start run id
+      std::vector<Int_t> mStop_runId        ; /// Stop run id
+      std::vector<Double_t> mStart_zvertex  ; /// Start z-vertex (cm)
+      std::vector<Double_t> mStop_zvertex   ; /// Stop z-vertex (cm)
+      std::vector<Double_t> mNormalize_stop ; /// Normalization between MC and data (normalized in refmult>mNormalize_stop)
+      std::vector<Int_t> mCentrality_bins[mNCentrality+1] ; /// Centrality bins (last value is set to 5000)
+      std::vector<Double_t> mPar_z_vertex[mNPar_z_vertex] ; /// parameters for z-vertex correction
+      std::vector<Double_t> mPar_weight[mNPar_weight] ; /// parameters for weight correction
+      std::vector<Double_t> mPar_luminosity[mNPar_luminosity] ; /// parameters for luminosity correction (valid only for 200 GeV)
+      std::vector<Parameters> mParameters ; /// One block per parameter set, same index as mParameterIndex
+
+      // Run lookup: mRunIndexPar[i] is the first parameter set covering [mRunIndexEdge[i], mRunIndexEdge[i+1])
+      std::vector<Int_t> mRunIndexEdge ;
+      std::vector<Int_t> mRunIndexPar ;
+
+      std::multimap<std::pair<Double_t, Int_t>, Int_t> mBeginRun ; /// Begin run number for a given (energy, year)
+      std::multimap<std::pair<Double_t, Int_t>, Int_t> mEndRun   ; /// End run number for a given (energy, year)
+      std::vector<Int_t> mBadRun ; /// Bad run number list (sorted)
+
+      // [6][680];
+      Int_t mnVzBinForWeight ; /// vz bin size for scale factor
+      std::vector<Double_t> mVzEdgeForWeight ; /// vz edge value
+      std::vector<Double_t> mgRefMultTriggerCorrDiffVzScaleRatio ; /// Scale factor for global refmult
+
+      Tables() : mnVzBinForWeight(0) {}
+    };
+
+    StRefMultCorr(const TString name, const std::shared_ptr<const Tables>& tables) ; /// Used by clone()
+
     const TString mName ; // refmult, refmult2, refmult3 or toftray (case insensitive)
+    const Flavor mFlavor ; // resolved from mName
 
     // Functions
-    void read() ; /// Read input parameters from text file StRoot/StRefMultCorr/Centrality_def.txt
-    void readBadRuns() ; /// Read bad run numbers
-    void clear() ; /// Clear all arrays
+    void read(Tables& tables) const ; /// Read input parameters from the compiled-in table or Centrality_def_*.txt
+    void readBadRuns(Tables& tables) const ; /// Read bad run numbers
+    static void addParameterSet(Tables& tables, const Double_t* row) ; /// One Centrality_def row, file column order
+    void clear() ; /// Reset the run and event state
+    void setTables(const std::shared_ptr<const Tables>& tables) ; /// Replace the tables, keeps the current parameter index
     Bool_t isIndexOk() const ; /// 0 <= mParameterIndex < maxArraySize
     Bool_t isZvertexOk() const ; /// mStart_zvertex < z < mStop_zvertex
     Bool_t isRefMultOk() const ; /// 0-80%, (corrected multiplicity) > mCentrality_bins[0]
     Bool_t isCentralityOk(const Int_t icent) const ; /// centrality bin check
     Int_t setParameterIndex(const Int_t RunId) ; /// Parameter index from run id (return mParameterIndex)
+    Double_t correctRefMult(const Double_t RefMult_d, const Double_t z,
+        const Double_t zdcCoincidenceRate, const UInt_t flag) const ; /// Corrections applied to the smeared multiplicity
+    Int_t findCentralityBin16(const Double_t refMultCorr) const ; /// Branchless lower bound over the 17 edges of mPar
+    static Int_t toCentralityBin9(const Int_t bin16) { return (bin16 < 0) ? -1 : (bin16 >= 14) ? bin16 - 7 : bin16/2 ; }
+    static void buildRunIndex(Tables& tables) ; /// Sorted run intervals for setParameterIndex, sorted bad run list
+    void buildParameters(Tables& tables) const ; /// Flat Parameters block per parameter set
+    static Bool_t isVpdMBgRefMult(const Flavor flavor) { return flavor >= kgRefMult_P16id && flavor <= kgRefMult_VpdMBnoVtx ; }
 
     // Special scale factor for Run14 to take into account the weight
     // between different triggers
     //  - return 1 for all the other runs
     Double_t getScaleForWeight() const ;
 
-    // Get table name based on the input multiplicity definition
+    // Get table (file) name based on the input multiplicity definition
     const Char_t* getTable() const ;
-
-    // Data members
-    enum {
-        mNCentrality   = 16, /// 16 centrality bins, starting from 75-80% with 5% bin width
-        mNPar_z_vertex = 8,
-        mNPar_weight   = 8,
-        mNPar_luminosity = 2
-    };
+    static TString& inputDirectory() ; /// Empty for the compiled-in tables
 
     // Use these variables to avoid varying the corrected multiplicity
     // in the same event by random numbers
     UShort_t mRefMult ;     /// Current multiplicity
     Double_t mVz ;          /// Current primary z-vertex
     Double_t mZdcCoincidenceRate ; /// Current ZDC coincidence rate
+    Bool_t   mKeyedEvent ;  /// Current event smeared with the (run, event) keyed generator
+    Int_t    mEventRunId ;  /// Key of the current event
+    Int_t    mEventId ;     /// Key of the current event
     Double_t mRefMult_corr; /// Corrected refmult
+    TRandom* mRandom ;      /// Generator for the refmult smearing, gRandom if null
 
-    std::vector<Int_t> mYear              ; /// Year
-    std::vector<Int_t> mStart_runId       ; /// Start run id
-    std::vector<Int_t> mStop_runId        ; /// Stop run id
-    std::vector<Double_t> mStart_zvertex  ; /// Start z-vertex (cm)
-    std::vector<Double_t> mStop_zvertex   ; /// Stop z-vertex (cm)
-    std::vector<Double_t> mNormalize_stop ; /// Normalization between MC and data (normalized in refmult>mNormalize_stop)
-    std::vector<Int_t> mCentrality_bins[mNCentrality+1] ; /// Centrality bins (last value is set to 5000)
-    std::vector<Double_t> mPar_z_vertex[mNPar_z_vertex] ; /// parameters for z-vertex correction
-    std::vector<Double_t> mPar_weight[mNPar_weight] ; /// parameters for weight correction
-    std::vector<Double_t> mPar_luminosity[mNPar_luminosity] ; /// parameters for luminosity correction (valid only for 200 GeV)
     Int_t mParameterIndex; /// Index of correction parameters
+    Int_t mCurrentRunId;   /// Run id of the last init() call, -1 before the first one
+    const Parameters* mPar ; /// Block of mParameterIndex in mTables, null if invalid
 
-    std::multimap<std::pair<Double_t, Int_t>, Int_t> mBeginRun ; /// Begin run number for a given (energy, year)
-    std::multimap<std::pair<Double_t, Int_t>, Int_t> mEndRun   ; /// End run number for a given (energy, year)
-    std::vector<Int_t> mBadRun ; /// Bad run number list
-
-    // [6][680];
-    Int_t mnVzBinForWeight ; /// vz bin size for scale factor
-    std::vector<Double_t> mVzEdgeForWeight ; /// vz edge value
-    std::vector<Double_t> mgRefMultTriggerCorrDiffVzScaleRatio ; /// Scale factor for global refmult
+    std::shared_ptr<const Tables> mTables ; //! Parsed input, shared between clones
 
     ClassDef(StRefMultCorr, 0)
 };
 #endif
-
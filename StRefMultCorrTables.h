@@ -0,0 +1,37 @@
+#ifndef StRefMultCorrTables_H
+#define StRefMultCorrTables_H
+
+//Compiled-in copies of the StRefMultCorrFiles/ inputs, so StRefMultCorr needs no
+//file access. StRefMultCorrTables.cpp is generated by makeRefMultCorrTables.sh
+//(see the Makefile), the text files stay the source of truth.
+namespace StRefMultCorrTables {
+
+    //Year Energy Start_runId Stop_runId Start_z_vertex Stop_z_vertex, 16 centrality bins,
+    //Normalize_stop, 8 z-vertex, 8 weight and 2 luminosity parameters
+    constexpr int nColumns = 41;
+
+    //Centrality_def_*.txt, rows in file order
+    struct CentralityDef {
+        const char* fileName;
+        int nRows;
+        const double* values; //nRows*nColumns
+    };
+
+    //bad_runs_refmult_year*.txt
+    struct BadRuns {
+        const char* fileName;
+        int nRuns;
+        const int* runs;
+    };
+
+    extern const CentralityDef centralityDefs[];
+    extern const int nCentralityDefs;
+    extern const BadRuns badRuns[];
+    extern const int nBadRuns;
+
+    //Lookup by file name without directory, null if the file was not embedded
+    const CentralityDef* findCentralityDef(const char* fileName);
+    const BadRuns* findBadRuns(const char* fileName);
+}
+
+#endif
@@ -33,6 +33,31 @@ public:
     unsigned int eventPlaneMult  = 0;    
     unsigned int subEventPlaneMult_A  = 0;
     unsigned int subEventPlaneMult_B  = 0;    
+
+    //Raw planes for harmonics n = 1..nHarmonics, stored at index n-1
+    static const int kMaxHarmonics = 6;
+    unsigned int nHarmonics = 0;
+    double raw_Qx[kMaxHarmonics]    = {};
+    double raw_Qy[kMaxHarmonics]    = {};
+    double raw_Qx_A[kMaxHarmonics]  = {};
+    double raw_Qy_A[kMaxHarmonics]  = {};
+    double raw_Qx_B[kMaxHarmonics]  = {};
+    double raw_Qy_B[kMaxHarmonics]  = {};
+    double raw_psi[kMaxHarmonics]   = {};
+    double raw_psi_A[kMaxHarmonics] = {};
+    double raw_psi_B[kMaxHarmonics] = {};
+
+    //Recentered and flattened, filled when an event plane calibration is set
+    bool calibrated = false;
+    double Qx[kMaxHarmonics]    = {};
+    double Qy[kMaxHarmonics]    = {};
+    double Qx_A[kMaxHarmonics]  = {};
+    double Qy_A[kMaxHarmonics]  = {};
+    double Qx_B[kMaxHarmonics]  = {};
+    double Qy_B[kMaxHarmonics]  = {};
+    double psi[kMaxHarmonics]   = {};
+    double psi_A[kMaxHarmonics] = {};
+    double psi_B[kMaxHarmonics] = {};
 };
 
 #endif
\ No newline at end of file
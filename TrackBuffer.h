@@ -0,0 +1,65 @@
+#ifndef TrackBuffer_H
+#define TrackBuffer_H
+
+#include <vector>
+#include <cmath>
+
+//Per-event structure-of-arrays view of the selected tracks.
+//Kinematics are decoded once when a track is added and then shared by
+//histogramming, hadronic correction, jet input and the event plane.
+class TrackBuffer {
+public:
+    enum QualityBit : unsigned char {
+        kPrimary = 1 << 0,
+        kTowerMatched = 1 << 1
+    };
+
+    void clear(){
+        index.clear(); quality.clear(); charge.clear(); towerIndex.clear();
+        px.clear(); py.clear(); pz.clear(); e.clear();
+        pt.clear(); eta.clear(); phi.clear();
+    }
+
+    void reserve(size_t n){
+        index.reserve(n); quality.reserve(n); charge.reserve(n); towerIndex.reserve(n);
+        px.reserve(n); py.reserve(n); pz.reserve(n); e.reserve(n);
+        pt.reserve(n); eta.reserve(n); phi.reserve(n);
+    }
+
+    size_t size() const {return index.size();}
+    bool hasBit(size_t i, QualityBit bit) const {return quality[i] & bit;}
+
+    //mass is the hypothesis used for the energy column, towerIdx < 0 if unmatched
+    size_t add(int idx, double x, double y, double z, double mass, int q, int towerIdx, unsigned char bits){
+        double pt2 = x*x + y*y;
+        double trkPt = sqrt(pt2);
+        index.push_back(idx);
+        quality.push_back(bits | ((towerIdx >= 0) ? kTowerMatched : 0));
+        charge.push_back(q);
+        towerIndex.push_back(towerIdx);
+        px.push_back(x);
+        py.push_back(y);
+        pz.push_back(z);
+        e.push_back(sqrt(pt2 + z*z + mass*mass));
+        pt.push_back(trkPt);
+        eta.push_back((trkPt > 0) ? asinh(z/trkPt) : ((z >= 0) ? 1e10 : -1e10));
+        phi.push_back(atan2(y, x));
+        return index.size() - 1;
+    }
+
+    std::vector<int> index;
+    std::vector<unsigned char> quality;
+    std::vector<int> charge;
+    std::vector<int> towerIndex;
+
+    std::vector<double> px;
+    std::vector<double> py;
+    std::vector<double> pz;
+    std::vector<double> e;
+
+    std::vector<double> pt;
+    std::vector<double> eta;
+    std::vector<double> phi;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#define TrackSelector_cxx
+
+#include "TrackSelector.h"
+
+#include "StPicoDst.h"
+#include "StPicoTrack.h"
+
+#include "TVector3.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+TrackSelector::TrackSelector(){
+    configure(0.2, 30.0, 1.0, 15, 0.52, 3.0);
+}
+
+const char* TrackSelector::getKernelName(){
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void TrackSelector::configure(double ptMin, double ptMax, double absEtaMax, int nHitsFitMin, double nHitsRatioMin, double dcaMax){
+    pt2Min = (ptMin > 0) ? ptMin*ptMin : 0;
+    pt2Max = ptMax*ptMax;
+    //|eta| <= etaMax  <=>  pz^2 <= pt^2 * sinh^2(etaMax)
+    double s = sinh(absEtaMax);
+    sinh2EtaMax = s*s;
+    dca2Max = dcaMax*dcaMax;
+    //Smallest nHitsFit passing both hit cuts for each nHitsMax, using the same
+    //double division as the per-track cut so the two agree exactly
+    for(int m = 0; m < nHitsMaxSize; m++){
+        int f = 0;
+        while(f < nHitsMaxSize && (f < nHitsFitMin || (f/(double)m) < nHitsRatioMin)) f++;
+        minFit[m] = f;
+    }
+}
+
+void TrackSelector::gather(StPicoDst* picoDst, const TVector3& pVtx){
+    nTracks = picoDst->numberOfTracks();
+    px.resize(nTracks);
+    py.resize(nTracks);
+    pz.resize(nTracks);
+    dcax.resize(nTracks);
+    dcay.resize(nTracks);
+    dcaz.resize(nTracks);
+    fitMargin.resize(nTracks);
+    const float vx = pVtx.X(), vy = pVtx.Y(), vz = pVtx.Z();
+    for(size_t i = 0; i < nTracks; i++){
+        StPicoTrack* trk = picoDst->track(i);
+        if(!trk){
+            //zero momentum fails the primary requirement
+            px[i] = py[i] = pz[i] = 0;
+            dcax[i] = dcay[i] = dcaz[i] = 0;
+            fitMargin[i] = -1;
+            continue;
+        }
+        //scalar accessors, no temporary TVector3 per track
+        px[i] = trk->pMomX();
+        py[i] = trk->pMomY();
+        pz[i] = trk->pMomZ();
+        dcax[i] = trk->gDCAx(vx);
+        dcay[i] = trk->gDCAy(vy);
+        dcaz[i] = trk->gDCAz(vz);
+        int nHitsMax = trk->nHitsMax();
+        if(nHitsMax < 0) nHitsMax = 0;
+        if(nHitsMax >= nHitsMaxSize) nHitsMax = nHitsMaxSize - 1;
+        fitMargin[i] = trk->nHitsFit() - minFit[nHitsMax];
+    }
+}
+
+bool TrackSelector::accept(size_t i) const {
+    double pt2 = px[i]*px[i] + py[i]*py[i];
+    double pz2 = pz[i]*pz[i];
+    double dca2 = dcax[i]*dcax[i] + dcay[i]*dcay[i] + dcaz[i]*dcaz[i];
+    return (pt2 + pz2 > 0) && (fitMargin[i] >= 0) && (dca2 <= dca2Max)
+        && (pt2 >= pt2Min) && (pt2 <= pt2Max) && (pz2 <= pt2*sinh2EtaMax);
+}
+
+void TrackSelector::evaluate(){
+    mask.assign((nTracks + 63)/64, 0);
+    size_t i = 0;
+#if defined(__AVX__)
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d vPt2Min = _mm256_set1_pd(pt2Min);
+    const __m256d vPt2Max = _mm256_set1_pd(pt2Max);
+    const __m256d vSinh2 = _mm256_set1_pd(sinh2EtaMax);
+    const __m256d vDca2Max = _mm256_set1_pd(dca2Max);
+    for(; i + 4 <= nTracks; i += 4){
+        __m256d x = _mm256_loadu_pd(&px[i]);
+        __m256d y = _mm256_loadu_pd(&py[i]);
+        __m256d z = _mm256_loadu_pd(&pz[i]);
+        __m256d dx = _mm256_loadu_pd(&dcax[i]);
+        __m256d dy = _mm256_loadu_pd(&dcay[i]);
+        __m256d dz = _mm256_loadu_pd(&dcaz[i]);
+        __m256d fit = _mm256_loadu_pd(&fitMargin[i]);
+        __m256d pt2 = _mm256_add_pd(_mm256_mul_pd(x, x), _mm256_mul_pd(y, y));
+        __m256d pz2 = _mm256_mul_pd(z, z);
+        __m256d dca2 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+        __m256d ok = _mm256_cmp_pd(_mm256_add_pd(pt2, pz2), zero, _CMP_GT_OQ);
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(fit, zero, _CMP_GE_OQ));
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(dca2, vDca2Max, _CMP_LE_OQ));
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(pt2, vPt2Min, _CMP_GE_OQ));
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(pt2, vPt2Max, _CMP_LE_OQ));
+        ok = _mm256_and_pd(ok, _mm256_cmp_pd(pz2, _mm256_mul_pd(pt2, vSinh2), _CMP_LE_OQ));
+        mask[i >> 6] |= (uint64_t)_mm256_movemask_pd(ok) << (i & 63);
+    }
+#elif defined(__SSE2__)
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d vPt2Min = _mm_set1_pd(pt2Min);
+    const __m128d vPt2Max = _mm_set1_pd(pt2Max);
+    const __m128d vSinh2 = _mm_set1_pd(sinh2EtaMax);
+    const __m128d vDca2Max = _mm_set1_pd(dca2Max);
+    for(; i + 2 <= nTracks; i += 2){
+        __m128d x = _mm_loadu_pd(&px[i]);
+        __m128d y = _mm_loadu_pd(&py[i]);
+        __m128d z = _mm_loadu_pd(&pz[i]);
+        __m128d dx = _mm_loadu_pd(&dcax[i]);
+        __m128d dy = _mm_loadu_pd(&dcay[i]);
+        __m128d dz = _mm_loadu_pd(&dcaz[i]);
+        __m128d fit = _mm_loadu_pd(&fitMargin[i]);
+        __m128d pt2 = _mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y));
+        __m128d pz2 = _mm_mul_pd(z, z);
+        __m128d dca2 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        __m128d ok = _mm_cmpgt_pd(_mm_add_pd(pt2, pz2), zero);
+        ok = _mm_and_pd(ok, _mm_cmpge_pd(fit, zero));
+        ok = _mm_and_pd(ok, _mm_cmple_pd(dca2, vDca2Max));
+        ok = _mm_and_pd(ok, _mm_cmpge_pd(pt2, vPt2Min));
+        ok = _mm_and_pd(ok, _mm_cmple_pd(pt2, vPt2Max));
+        ok = _mm_and_pd(ok, _mm_cmple_pd(pz2, _mm_mul_pd(pt2, vSinh2)));
+        mask[i >> 6] |= (uint64_t)_mm_movemask_pd(ok) << (i & 63);
+    }
+#endif
+    for(; i < nTracks; i++){
+        if(accept(i)) mask[i >> 6] |= (uint64_t)1 << (i & 63);
+    }
+}
+
+size_t TrackSelector::select(StPicoDst* picoDst, const TVector3& pVtx){
+    gather(picoDst, pVtx);
+    evaluate();
+    return nTracks;
+}
+
+size_t TrackSelector::nSelected() const {
+    size_t n = 0;
+    for(uint64_t word : mask){
+        for(; word; word &= word - 1) n++;
+    }
+    return n;
+}
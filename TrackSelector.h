@@ -0,0 +1,59 @@
+#ifndef TrackSelector_H
+#define TrackSelector_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class StPicoDst;
+class TVector3;
+
+//Batch track-quality selection. The raw columns of one event are gathered
+//first and all cuts are then evaluated together into a bitmask, using AVX or
+//SSE2 when the library is compiled for it and a scalar loop otherwise.
+class TrackSelector {
+public:
+    TrackSelector();
+    virtual ~TrackSelector(){}
+
+    //Bakes the cut values into squared bounds and the nHitsFit lookup table
+    void configure(double ptMin, double ptMax, double absEtaMax, int nHitsFitMin, double nHitsRatioMin, double dcaMax);
+
+    //Returns the number of tracks examined, query the result with isSelected()
+    size_t select(StPicoDst* picoDst, const TVector3& pVtx);
+
+    size_t size() const {return nTracks;}
+    size_t nSelected() const;
+    bool isSelected(size_t i) const {return (mask[i >> 6] >> (i & 63)) & 1;}
+
+    double getPx(size_t i) const {return px[i];}
+    double getPy(size_t i) const {return py[i];}
+    double getPz(size_t i) const {return pz[i];}
+
+    static const char* getKernelName();
+
+private:
+    void gather(StPicoDst* picoDst, const TVector3& pVtx);
+    void evaluate();
+    bool accept(size_t i) const;
+
+    static const int nHitsMaxSize = 256;
+
+    double pt2Min = 0;
+    double pt2Max = 0;
+    double sinh2EtaMax = 0;
+    double dca2Max = 0;
+    int minFit[nHitsMaxSize];
+
+    size_t nTracks = 0;
+    std::vector<double> px;
+    std::vector<double> py;
+    std::vector<double> pz;
+    std::vector<double> dcax;
+    std::vector<double> dcay;
+    std::vector<double> dcaz;
+    std::vector<double> fitMargin;
+    std::vector<uint64_t> mask;
+};
+
+#endif
@@ -0,0 +1,106 @@
+//End-to-end throughput benchmark: writes a synthetic StPicoDst file and runs
+//PicoDstAnalyzer::run() over it. Exits early if the BEMC geometry tables do not
+//match the runtime computation.
+//
+//Usage: picoDstBench [key=value ...]
+//  events=5000 threads=1 seed=12345 maxGRefMult=600 tracksPerGRefMult=2
+//  towerOccupancy=0.2 mcTracks=0 jets=1 flow=0 regenerate=1 file=synthetic.picoDst.root
+//  centBench=0 eventsPerRun=1000
+//centBench=N only runs the StRefMultCorr microbenchmark (RefMultCorrBench.h) over N events.
+
+#include "SyntheticPicoDstMaker.h"
+#include "RefMultCorrBench.h"
+
+#include "PicoDstAnalyzer.h"
+#include "PerformanceMonitor.h"
+#include "BEMCLocator.h"
+#include "FlowCumulantMaker.h"
+
+#include "TSystem.h"
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <cstdlib>
+
+using namespace std;
+
+int main(int argc, char** argv){
+    map<string, string> args = {
+        {"events", "5000"},
+        {"threads", "1"},
+        {"seed", "12345"},
+        {"maxGRefMult", "600"},
+        {"tracksPerGRefMult", "2"},
+        {"towerOccupancy", "0.2"},
+        {"mcTracks", "0"},
+        {"jets", "1"},
+        {"flow", "0"},
+        {"regenerate", "1"},
+        {"file", "synthetic.picoDst.root"},
+        {"centBench", "0"},
+        {"eventsPerRun", "1000"}
+    };
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if(eq == string::npos || args.find(arg.substr(0, eq)) == args.end()){
+            cout<<"Unknown argument "<<arg<<endl;
+            return 1;
+        }
+        args[arg.substr(0, eq)] = arg.substr(eq+1);
+    }
+
+    //compile-time tower tables against the runtime geometry
+    if(!BEMCLocator::checkGeometry()) return 1;
+
+    if(atol(args["centBench"].c_str()) > 0){
+        return runRefMultCorrBench(atol(args["centBench"].c_str()), atoi(args["seed"].c_str()), atol(args["eventsPerRun"].c_str()));
+    }
+
+    long nEvents = atol(args["events"].c_str());
+    string picoFile = args["file"];
+    double nMcTracks = atof(args["mcTracks"].c_str());
+
+    if(args["regenerate"] != "0" || gSystem->AccessPathName(picoFile.c_str())){
+        SyntheticPicoDstMaker maker(picoFile, atoi(args["seed"].c_str()));
+        maker.setMaxGRefMult(atof(args["maxGRefMult"].c_str()));
+        maker.setTracksPerGRefMult(atof(args["tracksPerGRefMult"].c_str()));
+        maker.setTowerOccupancy(atof(args["towerOccupancy"].c_str()));
+        maker.setNMcTracks(nMcTracks);
+        maker.make(nEvents);
+    }
+
+    PicoDstAnalyzer ana(picoFile, nEvents, "bench_output.root");
+    ana.setNThreads(atoi(args["threads"].c_str()));
+    if(args["jets"] != "0"){
+        ana.getFjWrapper();
+        if(nMcTracks > 0) ana.getGenFjWrapper();
+    }
+    if(args["flow"] != "0"){
+        ana.getFlowMaker()->setOutFileName("bench_flow.root");
+    }
+
+    ana.addHist1D("hCentrality", "Centrality", 20, 0, 100);
+    ana.addHist1D("hRefMult", "gRefMult corrected", 800, 0, 800);
+    ana.addHist1D("hNJets", "N jets", 50, 0, 50);
+    ana.addHist1D("hNGenJets", "N gen jets", 50, 0, 50);
+    ana.addHist1D("hTrackPt", "Track p_{T}", 300, 0, 30);
+    ana.addHist1D("hTrackEta", "Track #eta", 40, -1, 1);
+    ana.addHist1D("hTrackPhi", "Track #phi", 64, -3.2, 3.2);
+    ana.addHist1D("hTowerEt", "Tower E_{T}", 300, 0, 30);
+    ana.addHist1D("hTowerEta", "Tower #eta", 40, -1, 1);
+    ana.addHist1D("hTowerPhi", "Tower #phi", 64, -3.2, 3.2);
+    ana.addHist1D("hJetPt", "Jet p_{T}", 100, 0, 100);
+    ana.addHist2D("h2JetPtvEta", "Jet p_{T} vs #eta", 100, 0, 100, 40, -1, 1);
+    if(nMcTracks > 0){
+        ana.addHist1D("hGenTrackPt", "Gen track p_{T}", 300, 0, 30);
+        ana.addHist1D("hGenJetPt", "Gen jet p_{T}", 100, 0, 100);
+    }
+
+    ana.run();
+
+    const PerformanceMonitor& perf = ana.getPerformanceMonitor();
+    cout<<"BENCH "<<perf.toJSON()<<endl;
+    return 0;
+}
@@ -0,0 +1,175 @@
+#include "RefMultCorrBench.h"
+
+#include "StRefMultCorr.h"
+#include "CentralityMaker.h"
+
+#include "TRandom3.h"
+#include "TMath.h"
+#include "TString.h"
+
+#include <chrono>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+    struct BenchEvent {
+        int runId;
+        unsigned short gRefMult;
+        double vz;
+        double zdcx;
+    };
+
+    struct BenchResult {
+        int cent16;
+        int cent9;
+        double refMultCorr;
+        double weight;
+    };
+
+    //Correction code path as it was before the flat parameter block
+    class ReferenceCorr {
+    public:
+        ReferenceCorr(const TString& n) : name(n) {}
+
+        void compute(const StRefMultCorr::Parameters& par, const BenchEvent& ev, TRandom& random, BenchResult& res) const {
+            double corr = ev.gRefMult;
+            if(ev.vz > par.startZvertex && ev.vz < par.stopZvertex) corr = refMultCorr(par, ev, random);
+            res.refMultCorr = corr;
+            res.cent16 = centralityBin16(par, corr);
+            res.cent9 = centralityBin9(par, corr, res.cent16);
+            res.weight = weight(par, corr, ev.vz);
+        }
+
+    private:
+        TString name;
+
+        double refMultCorr(const StRefMultCorr::Parameters& par, const BenchEvent& ev, TRandom& random) const {
+            const double par0l = par.luminosity[0];
+            const double par1l = par.luminosity[1];
+            double correction_luminosity = (par0l==0.0) ? 1.0 : 1.0/(1.0 + par1l/par0l*ev.zdcx/1000.);
+            if(name.CompareTo("grefmult_P16id", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_P17id_VpdMB30", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_P18ih_VpdMB30", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_P18ih_VpdMB30_AllLumi", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_P18ih_VpdMB30_AllLumi_MB5sc", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_VpdMB30", TString::kIgnoreCase) == 0 ||
+               name.CompareTo("grefmult_VpdMBnoVtx", TString::kIgnoreCase) == 0 ) {
+                float zdcmean = 0;
+                if(par.year == 2014) zdcmean = 30.;
+                if(par.year == 2016) zdcmean = 50.;
+                correction_luminosity = (par0l==0.0) ? correction_luminosity : correction_luminosity*(par0l+par1l*zdcmean)/par0l;
+            }
+            const double* p = par.zvertex;
+            const double z = ev.vz;
+            const double RefMult_z = p[0] + p[1]*z + p[2]*z*z + p[3]*z*z*z + p[4]*z*z*z*z + p[5]*z*z*z*z*z + p[6]*z*z*z*z*z*z;
+            double Hovno = 1.0;
+            if(RefMult_z > 0.0) Hovno = (p[0] + p[7])/RefMult_z;
+            return ((double)ev.gRefMult + random.Rndm())*Hovno*correction_luminosity;
+        }
+
+        bool centralityOk(const StRefMultCorr::Parameters& par, double corr, int icent) const {
+            if(icent == -1) return corr <= par.centralityBins[0];
+            if(icent == 16) return corr <= par.centralityBins[16];
+            return corr > par.centralityBins[icent] && corr <= par.centralityBins[icent+1];
+        }
+
+        int centralityBin16(const StRefMultCorr::Parameters& par, double corr) const {
+            int bin = -1;
+            while(bin < 16 && !centralityOk(par, corr, bin)) bin++;
+            return (bin == 16) ? -1 : bin;
+        }
+
+        int centralityBin9(const StRefMultCorr::Parameters& par, double corr, int bin16) const {
+            if(bin16 < 0 || bin16 >= 16) return -1;
+            if(corr > par.centralityBins[15] && corr <= par.centralityBins[16]) return 8;
+            if(corr > par.centralityBins[14] && corr <= par.centralityBins[15]) return 7;
+            return (int)(0.5*bin16);
+        }
+
+        double weight(const StRefMultCorr::Parameters& par, double corr, double vz) const {
+            double w = 1.0;
+            if(!(vz > par.startZvertex && vz < par.stopZvertex)) return w;
+            const double* p = par.weight;
+            bool refMultOk = corr > par.centralityBins[0] && corr < par.centralityBins[16];
+            if(refMultOk && corr < par.normalizeStop && corr != -(p[3]/p[2])){
+                w = p[0]
+                    + p[1]/(p[2]*corr + p[3])
+                    + p[4]*(p[2]*corr + p[3])
+                    + p[6]/TMath::Power(p[2]*corr + p[3], 2)
+                    + p[7]*TMath::Power(p[2]*corr + p[3], 2);
+                w = w + (w - 1.0)*(p[5]*vz*vz);
+            }
+            //no trigger scale factors are loaded for the benchmarked table
+            return w;
+        }
+    };
+}
+
+int runRefMultCorrBench(long nEvents, unsigned int seed, long eventsPerRun){
+    StRefMultCorr* corr = CentralityMaker::instance()->getgRefMultCorr_P18ih_VpdMB30_AllLumi();
+    ReferenceCorr reference(corr->getName());
+
+    //Run14 Au+Au range of the table, events come in blocks of eventsPerRun per run
+    TRandom3 random(seed);
+    vector<BenchEvent> events(nEvents);
+    int runId = 0;
+    for(long i = 0; i < nEvents; i++){
+        if(eventsPerRun <= 1 || i%eventsPerRun == 0) runId = 15076101 + random.Integer(15167014 - 15076101 + 1);
+        double x = random.Rndm();
+        events[i] = {runId, (unsigned short)random.Poisson(600*x*x), random.Uniform(-6., 6.), random.Uniform(5000., 60000.)};
+    }
+
+    //runs outside the parameter sets would stop StRefMultCorr, keep only valid ones
+    vector<BenchEvent> valid;
+    for(auto& ev : events){
+        corr->init(ev.runId);
+        if(corr->getParameters()) valid.push_back(ev);
+    }
+    if(valid.empty()){
+        cout<<"RefMultCorrBench: no event falls into a parameter set of "<<corr->getName()<<endl;
+        return 1;
+    }
+
+    typedef chrono::steady_clock Clock;
+    vector<BenchResult> current(valid.size()), ref(valid.size());
+
+    TRandom3 randomCurrent(seed + 1);
+    corr->setRandom(&randomCurrent);
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < valid.size(); i++){
+        const BenchEvent& ev = valid[i];
+        corr->init(ev.runId);
+        corr->initEvent(ev.gRefMult, ev.vz, ev.zdcx);
+        current[i] = {corr->getCentralityBin16(), corr->getCentralityBin9(), corr->getRefMultCorr(), corr->getWeight()};
+    }
+    double nsCurrent = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+    corr->setRandom(nullptr);
+
+    TRandom3 randomRef(seed + 1);
+    start = Clock::now();
+    for(size_t i = 0; i < valid.size(); i++){
+        const BenchEvent& ev = valid[i];
+        corr->init(ev.runId);
+        reference.compute(*corr->getParameters(), ev, randomRef, ref[i]);
+    }
+    double nsRef = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+
+    long nMismatch = 0;
+    double maxRelDiff = 0;
+    for(size_t i = 0; i < valid.size(); i++){
+        if(current[i].cent16 != ref[i].cent16 || current[i].cent9 != ref[i].cent9) nMismatch++;
+        for(double d : {fabs(current[i].refMultCorr - ref[i].refMultCorr)/max(1.0, fabs(ref[i].refMultCorr)),
+                        fabs(current[i].weight - ref[i].weight)/max(1.0, fabs(ref[i].weight))}){
+            maxRelDiff = max(maxRelDiff, d);
+        }
+    }
+
+    cout<<"RefMultCorrBench: "<<valid.size()<<" events, "<<eventsPerRun<<" per run"<<endl;
+    cout<<"  reference: "<<nsRef/valid.size()<<" ns/event"<<endl;
+    cout<<"  current:   "<<nsCurrent/valid.size()<<" ns/event"<<endl;
+    cout<<"  centrality mismatches: "<<nMismatch<<", max relative deviation: "<<maxRelDiff<<endl;
+    return (nMismatch == 0 && maxRelDiff < 1e-9) ? 0 : 1;
+}
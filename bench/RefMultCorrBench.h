@@ -0,0 +1,10 @@
+#ifndef RefMultCorrBench_H
+#define RefMultCorrBench_H
+
+//Per-event centrality cost of StRefMultCorr (flat parameter block, Horner
+//polynomials) against a reference that evaluates the same corrections the way
+//StRefMultCorr used to: name compares, repeated multiplications, TMath::Power
+//and the 16-bin scan. Returns non-zero if the two disagree.
+int runRefMultCorrBench(long nEvents, unsigned int seed, long eventsPerRun);
+
+#endif
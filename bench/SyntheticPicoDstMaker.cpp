@@ -0,0 +1,145 @@
+#define SyntheticPicoDstMaker_cxx
+
+#include "SyntheticPicoDstMaker.h"
+
+#include "StPicoArrays.h"
+#include "StPicoEvent.h"
+#include "StPicoTrack.h"
+#include "StPicoBTowHit.h"
+#include "StPicoMcTrack.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TClonesArray.h"
+#include "TRandom3.h"
+#include "TMath.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+SyntheticPicoDstMaker::SyntheticPicoDstMaker(string outfile, unsigned int seed){
+    //StPicoDstReader only accepts *.picoDst.root or file lists
+    assert(outfile.find(".picoDst.root") != string::npos);
+    outFileName = outfile;
+    random = new TRandom3(seed);
+}
+
+SyntheticPicoDstMaker::~SyntheticPicoDstMaker(){
+    delete random;
+}
+
+int SyntheticPicoDstMaker::arrayIndex(const char* name) const {
+    for(int i = 0; i < StPicoArrays::NAllPicoArrays; i++){
+        if(strcmp(StPicoArrays::picoArrayNames[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+void SyntheticPicoDstMaker::make(long nEvents){
+    TFile outFile(outFileName.c_str(), "RECREATE");
+    TTree* tree = new TTree("PicoDst", "Synthetic StPicoDst");
+    arrays.assign(StPicoArrays::NAllPicoArrays, nullptr);
+    for(int i = 0; i < StPicoArrays::NAllPicoArrays; i++){
+        arrays[i] = new TClonesArray(StPicoArrays::picoArrayTypes[i], StPicoArrays::picoArraySizes[i]);
+        tree->Branch(StPicoArrays::picoArrayNames[i], &arrays[i], 65536, 99);
+    }
+
+    cout<<"SyntheticPicoDstMaker: writing "<<nEvents<<" events to "<<outFileName<<endl;
+    for(long iev = 0; iev < nEvents; iev++){
+        for(auto& array : arrays) array->Clear();
+        makeEvent(iev);
+        tree->Fill();
+    }
+    outFile.Write();
+    outFile.Close();
+
+    for(auto& array : arrays) delete array;
+    arrays.clear();
+}
+
+void SyntheticPicoDstMaker::makeEvent(long iev){
+    vz = random->Uniform(-absZVtxMax, absZVtxMax);
+    vx = random->Gaus(0, 0.3);
+    vy = random->Gaus(0, 0.3);
+
+    //Flat impact parameter like sampling: many peripheral, few central events
+    double x = random->Rndm();
+    unsigned int gRefMult = random->Poisson(maxGRefMult*x*x);
+
+    StPicoEvent* event = static_cast<StPicoEvent*>(arrays[arrayIndex("Event")]->ConstructedAt(0));
+    event->setRunId(startRunId + random->Integer(stopRunId - startRunId + 1));
+    event->setEventId(iev);
+    event->setPrimaryVertexPosition(vx, vy, vz);
+    event->setGRefMult(gRefMult);
+    event->setZDCx(random->Uniform(5000., 60000.));
+
+    makeTracks(random->Poisson(tracksPerGRefMult*gRefMult));
+    makeTowers();
+    if(nMcTracks > 0) makeMcTracks(random->Poisson(nMcTracks));
+}
+
+void SyntheticPicoDstMaker::makeTracks(unsigned int nTracks){
+    TClonesArray* trackArray = arrays[arrayIndex("Track")];
+    for(unsigned int itrk = 0; itrk < nTracks; itrk++){
+        StPicoTrack* trk = static_cast<StPicoTrack*>(trackArray->ConstructedAt(itrk));
+        double pt = 0.1 + random->Exp(0.5);
+        double eta = random->Uniform(-1.2, 1.2);
+        double phi = random->Uniform(-TMath::Pi(), TMath::Pi());
+        double px = pt*cos(phi), py = pt*sin(phi), pz = pt*sinh(eta);
+        int charge = (random->Rndm() < 0.5) ? -1 : 1;
+
+        trk->setId(itrk);
+        //~90% of the tracks are primary, the rest only have a global momentum
+        if(random->Rndm() < 0.9) trk->setPrimaryMomentum(px, py, pz);
+        trk->setGlobalMomentum(px, py, pz);
+        trk->setOrigin(vx + random->Gaus(0, 0.7), vy + random->Gaus(0, 0.7), vz + random->Gaus(0, 0.7));
+        trk->setNHitsMax(45);
+        trk->setNHitsFit(charge*(10 + random->Integer(36)));
+        trk->setNHitsDedx(10 + random->Integer(36));
+        trk->setChi2(random->Exp(1.0));
+        trk->setBEmcMatchedTowerIndex((fabs(eta) < 1 && random->Rndm() < 0.3) ? random->Integer(4800) : -1);
+    }
+}
+
+void SyntheticPicoDstMaker::makeTowers(){
+    //The BTowHit array always holds all 4800 towers, indexed by softId-1
+    TClonesArray* towerArray = arrays[arrayIndex("BTowHit")];
+    for(int itow = 0; itow < 4800; itow++){
+        StPicoBTowHit* tow = static_cast<StPicoBTowHit*>(towerArray->ConstructedAt(itow));
+        if(random->Rndm() < towerOccupancy){
+            double e = 0.2 + random->Exp(0.8);
+            tow->setAdc(static_cast<int>(e/0.02));
+            tow->setEnergy(e);
+        }else{
+            tow->setAdc(0);
+            tow->setEnergy(0);
+        }
+    }
+}
+
+void SyntheticPicoDstMaker::makeMcTracks(unsigned int nMc){
+    TClonesArray* mcArray = arrays[arrayIndex("McTrack")];
+    for(unsigned int imc = 0; imc < nMc; imc++){
+        StPicoMcTrack* mc = static_cast<StPicoMcTrack*>(mcArray->ConstructedAt(imc));
+        double pt = 0.1 + random->Exp(1.0);
+        double eta = random->Uniform(-1.2, 1.2);
+        double phi = random->Uniform(-TMath::Pi(), TMath::Pi());
+        double px = pt*cos(phi), py = pt*sin(phi), pz = pt*sinh(eta);
+        bool neutral = random->Rndm() < 0.3;
+        int charge = neutral ? 0 : ((random->Rndm() < 0.5) ? -1 : 1);
+        double mass = neutral ? 0.135 : 0.13957;
+
+        //Geant ids: 7 = pi0, 8 = pi+, 9 = pi-
+        mc->setId(imc+1);
+        mc->setGePid(neutral ? 7 : ((charge > 0) ? 8 : 9));
+        mc->setCharge(charge);
+        mc->setP(px, py, pz);
+        mc->setE(sqrt(px*px + py*py + pz*pz + mass*mass));
+        mc->setIdVtxStart(1);
+        //~10% decay inside the detector and are dropped by genTrackLoop
+        mc->setIdVtxStop((random->Rndm() < 0.1) ? 2 : 0);
+    }
+}
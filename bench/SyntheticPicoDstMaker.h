@@ -0,0 +1,52 @@
+#ifndef SyntheticPicoDstMaker_H
+#define SyntheticPicoDstMaker_H
+
+#include <string>
+#include <vector>
+
+class TClonesArray;
+class TRandom3;
+
+//Writes a reproducible StPicoDst-format file (Event, Track, BTowHit, McTrack)
+//for offline throughput benchmarks of PicoDstAnalyzer
+class SyntheticPicoDstMaker {
+public:
+    SyntheticPicoDstMaker(std::string outfileName = "synthetic.picoDst.root", unsigned int seed = 12345);
+    virtual ~SyntheticPicoDstMaker();
+
+    void make(long nEvents);
+
+    void setMaxGRefMult(double mult){maxGRefMult = mult;}
+    void setTracksPerGRefMult(double n){tracksPerGRefMult = n;}
+    void setTowerOccupancy(double occ){towerOccupancy = occ;}
+    void setNMcTracks(double n){nMcTracks = n;}
+    void setAbsZVtxMax(double z){absZVtxMax = z;}
+    void setRunRange(int start, int stop){startRunId = start; stopRunId = stop;}
+
+private:
+    void makeEvent(long iev);
+    void makeTracks(unsigned int nTracks);
+    void makeTowers();
+    void makeMcTracks(unsigned int nMc);
+    int arrayIndex(const char* name) const;
+
+    std::string outFileName = "";
+    TRandom3* random = nullptr;
+    std::vector<TClonesArray*> arrays;
+
+    //Run14 Au+Au range of Centrality_def_grefmult_P18ih_VpdMB30_AllLumi.txt
+    int startRunId = 15076101;
+    int stopRunId = 15167014;
+
+    double maxGRefMult = 600;
+    double tracksPerGRefMult = 2.0;
+    double towerOccupancy = 0.2;
+    double nMcTracks = 0;
+    double absZVtxMax = 35.0;
+
+    double vz = 0;
+    double vx = 0;
+    double vy = 0;
+};
+
+#endif
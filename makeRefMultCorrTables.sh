@@ -0,0 +1,95 @@
+#!/bin/sh
+# Generates StRefMultCorrTables.cpp (see StRefMultCorrTables.h) from the StRefMultCorr input files
+#   usage: sh makeRefMultCorrTables.sh [StRefMultCorrFiles] > StRefMultCorrTables.cpp
+set -e
+
+DIR=${1:-StRefMultCorrFiles}
+NCOLUMNS=41
+
+echo "//Generated by makeRefMultCorrTables.sh from $DIR, do not edit"
+echo ""
+echo "#include \"StRefMultCorrTables.h\""
+echo ""
+echo "#include <cstring>"
+echo ""
+echo "namespace StRefMultCorrTables {"
+
+DEFS=""
+i=0
+for f in "$DIR"/Centrality_def_*.txt; do
+    [ -f "$f" ] || continue
+    name=$(basename "$f")
+    # Skip the header line, every following token is a number in file column order
+    awk -v var="centralityDef$i" -v name="$name" -v ncol=$NCOLUMNS '
+        NR == 1 { if (index($0, "Start_runId") == 0) { print name ": missing header line" > "/dev/stderr"; exit 1 } next }
+        {
+            sub(/\r$/, "")
+            for (k = 1; k <= NF; k++) {
+                if (n % ncol == 0) line = "       "
+                line = line " " $k ","
+                n++
+                if (n % ncol == 0) rows = rows line "\n"
+            }
+        }
+        END {
+            if (n == 0 || n % ncol != 0) { print name ": " n " values, not a multiple of " ncol > "/dev/stderr"; exit 1 }
+            print ""
+            print "    static const double " var "[] = {"
+            printf "%s", rows
+            print "    };"
+        }' "$f" || exit 1
+    nrows=$(awk 'NR > 1 { n += NF } END { print n/'$NCOLUMNS' }' "$f")
+    DEFS="$DEFS        {\"$name\", $nrows, centralityDef$i},
+"
+    i=$((i+1))
+done
+
+RUNS=""
+i=0
+for f in "$DIR"/bad_runs_refmult_year*.txt; do
+    [ -f "$f" ] || continue
+    name=$(basename "$f")
+    nruns=$(awk '{ sub(/\r$/, ""); n += NF } END { print n+0 }' "$f")
+    if [ "$nruns" -eq 0 ]; then
+        RUNS="$RUNS        {\"$name\", 0, 0},
+"
+    else
+        awk -v var="badRuns$i" '
+            BEGIN { print ""; print "    static const int " var "[] = {" }
+            { sub(/\r$/, ""); for (k = 1; k <= NF; k++) print "        " $k "," }
+            END { print "    };" }' "$f"
+        RUNS="$RUNS        {\"$name\", $nruns, badRuns$i},
+"
+    fi
+    i=$((i+1))
+done
+
+echo ""
+echo "    const CentralityDef centralityDefs[] = {"
+printf "%s" "$DEFS"
+echo "        {0, 0, 0}"
+echo "    };"
+echo "    const int nCentralityDefs = sizeof(centralityDefs)/sizeof(centralityDefs[0]) - 1;"
+echo ""
+echo "    const BadRuns badRuns[] = {"
+printf "%s" "$RUNS"
+echo "        {0, 0, 0}"
+echo "    };"
+echo "    const int nBadRuns = sizeof(badRuns)/sizeof(badRuns[0]) - 1;"
+cat <<'EOF'
+
+    const CentralityDef* findCentralityDef(const char* fileName){
+        for(int i = 0; i < nCentralityDefs; i++){
+            if(strcmp(centralityDefs[i].fileName, fileName) == 0) return &centralityDefs[i];
+        }
+        return 0;
+    }
+
+    const BadRuns* findBadRuns(const char* fileName){
+        for(int i = 0; i < nBadRuns; i++){
+            if(strcmp(badRuns[i].fileName, fileName) == 0) return &badRuns[i];
+        }
+        return 0;
+    }
+}
+EOF